@@ -116,11 +116,13 @@ main (int argc, char *argv[])
   bool MTable = true; //!< printing the main table
   bool NTable = false; //!< printing the neighbor table
   bool showPings = true;
+  bool flowlet = false; //!< flowlet load balancing instead of flow hashing
 
   CommandLine cmd;
   cmd.AddValue ("verbose", "Tell application to log if true", verbose);
   //cmd.AddValue ("NTable", "Print the Neighbor Table", NTable);
   cmd.AddValue ("MTable", "Print the Main Routing Table", MTable);
+  cmd.AddValue ("Flowlet", "Balance the equal-cost paths by flowlets instead of flow hashes", flowlet);
 
   cmd.Parse (argc,argv);
 
@@ -184,6 +186,9 @@ main (int argc, char *argv[])
   else if (NTable) 
     piorRouting.Set ("PrintingMethod", EnumValue(N_TABLE));
 
+  if (flowlet)
+    piorRouting.Set ("LoadBalancing", EnumValue (FLOWLET));
+
   Ipv4ListRoutingHelper list;
   list.Add (piorRouting, 0);
 
@@ -247,62 +252,15 @@ main (int argc, char *argv[])
   PIOHelper routingHelper;
   NS_LOG_UNCOND ("IsIni routingHelper: " << routingHelper.IsIni(a));
 
+  // The connected networks are installed by the routers from their interface
+  // addresses, the others are learned from the neighbors: A learns
+  // 172.16.1.0/30 through both B and C at equal cost
   Ptr<PIORoutingProtocol> pior = routingHelper.GetPIORouting (a->GetObject<Ipv4> ());
   if (pior)
-    {
-      NS_LOG_UNCOND ("IsIni piorProto: " << pior->IsInitialized());
-      pior->AddHostRouteTo (Ipv4Address ("127.0.0.1"), 0, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("192.168.16.0"), Ipv4Mask ("/30"), 1, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("15.16.16.0"), Ipv4Mask ("/24"), 2, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("203.15.19.0"), Ipv4Mask ("/24"), 3, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("172.16.1.0"), Ipv4Mask ("/30"), Ipv4Address ("203.15.19.2"), 3, 3, 4, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("172.16.1.0"), Ipv4Mask ("/30"), Ipv4Address ("15.16.16.2"), 2, 2, 4, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("10.10.10.0"), Ipv4Mask ("/24"), Ipv4Address ("15.16.16.2"), 2, 2, 4, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("11.118.126.0"), Ipv4Mask ("/24"), Ipv4Address ("15.16.16.2"), 2, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("201.13.15.0"), Ipv4Mask ("/24"), Ipv4Address ("15.16.16.2"), 2, 1, 2, Seconds (500), Seconds (500));
-    }
+    NS_LOG_UNCOND ("IsIni piorProto: " << pior->IsInitialized());
   else
     NS_LOG_UNCOND ("IsIni piorProto: NULL");
 
-  pior = routingHelper.GetPIORouting (b->GetObject<Ipv4> ());
-  if (pior)
-    {
-      pior->AddHostRouteTo (Ipv4Address ("127.0.0.1"), 0, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("15.16.16.0"), Ipv4Mask ("/24"), 1, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("201.13.15.0"), Ipv4Mask ("/24"), 2, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("11.118.126.0"), Ipv4Mask ("/24"), 3, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("10.10.10.0"), Ipv4Mask ("/24"), Ipv4Address ("11.118.126.2"), 3, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("203.15.19.0"), Ipv4Mask ("/24"), Ipv4Address ("11.118.126.2"), 3, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("172.16.1.0"), Ipv4Mask ("/30"), Ipv4Address ("201.13.15.2"), 2, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("192.168.16.0"), Ipv4Mask ("/30"), Ipv4Address ("15.16.16.1"), 1, 1, 2, Seconds (500), Seconds (500));
-    }
-
-  pior = routingHelper.GetPIORouting (c->GetObject<Ipv4> ());
-  if (pior)
-    {
-      pior->AddHostRouteTo (Ipv4Address ("127.0.0.1"), 0, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("203.15.19.0"), Ipv4Mask ("/24"), 1, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("10.10.10.0"), Ipv4Mask ("/24"), 2, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("11.118.126.0"), Ipv4Mask ("/24"), 3, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("172.16.1.0"), Ipv4Mask ("/30"), Ipv4Address ("10.10.10.2"), 2, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("201.13.15.0"), Ipv4Mask ("/24"), Ipv4Address ("10.10.10.2"), 2, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("15.16.16.0"), Ipv4Mask ("/24"), Ipv4Address ("203.15.19.1"), 1, 1, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("192.168.16.0"), Ipv4Mask ("/30"), Ipv4Address ("203.15.19.1"), 1, 1, 2, Seconds (500), Seconds (500));
-    }
-
-  pior = routingHelper.GetPIORouting (d->GetObject<Ipv4> ());
-  if (pior)
-    {
-      pior->AddHostRouteTo (Ipv4Address ("127.0.0.1"), 0, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("201.13.15.0"), Ipv4Mask ("/24"), 1, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("10.10.10.0"), Ipv4Mask ("/24"), 2, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("172.16.1.0"), Ipv4Mask ("/30"), 3, 0, 2, Seconds (0), Seconds (0));
-      pior->AddNetworkRouteTo (Ipv4Address ("192.168.16.0"), Ipv4Mask ("/30"), Ipv4Address ("201.13.15.1"), 1, 1, 4, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("203.15.19.0"), Ipv4Mask ("/24"), Ipv4Address ("201.13.15.1"), 1, 1, 4, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("11.118.126.0"), Ipv4Mask ("/24"), Ipv4Address ("201.13.15.1"), 1, 2, 2, Seconds (500), Seconds (500));
-      pior->AddNetworkRouteTo (Ipv4Address ("15.16.16.0"), Ipv4Mask ("/24"), Ipv4Address ("201.13.15.1"), 1, 2, 2, Seconds (500), Seconds (500));
-    }
-
   // Enable the printing option for the listRouting
   Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> (&std::cout);
   if (MTable || NTable)
@@ -18,6 +18,14 @@
 * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
 */
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "pior-helper.h"
 
 #include "ns3/pior.h"
@@ -25,9 +33,236 @@
 #include "ns3/node-list.h"
 #include "ns3/names.h"
 #include "ns3/ipv4-list-routing.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("PIOHelper");
 
 namespace ns3 {
 
+/**
+ * \brief Skip blanks.
+ * \param p current position
+ * \param end end of the line
+ * \return the first non-blank position
+ */
+static const char*
+SkipBlanks (const char *p, const char *end)
+{
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+      p++;
+    }
+  return p;
+}
+
+/**
+ * \brief Read a token.
+ * \param p current position, moved past the token
+ * \param end end of the line
+ * \param token set to the token
+ * \param length set to the token length
+ * \return false at the end of the line
+ */
+static bool
+NextToken (const char *&p, const char *end, const char *&token, uint32_t &length)
+{
+  p = SkipBlanks (p, end);
+  token = p;
+  while (p != end && *p != ' ' && *p != '\t' && *p != '\r')
+    {
+      p++;
+    }
+  length = p - token;
+  return length != 0;
+}
+
+/**
+ * \brief Parse a decimal number.
+ * \param p number text
+ * \param end end of the text
+ * \param value set to the number
+ * \return the position after the number, or 0 if there is no number
+ */
+static const char*
+ParseNumber (const char *p, const char *end, uint32_t &value)
+{
+  const char *start = p;
+  uint64_t number = 0;
+  while (p != end && *p >= '0' && *p <= '9' && number <= 0xffffffff)
+    {
+      number = number * 10 + (*p - '0');
+      p++;
+    }
+  if (p == start || number > 0xffffffff)
+    {
+      return 0;
+    }
+  value = uint32_t (number);
+  return p;
+}
+
+/**
+ * \brief Parse a dotted-quad IPv4 address.
+ * \param p address text
+ * \param end end of the text
+ * \param address set to the address, in host byte order
+ * \return the position after the address, or 0 if there is no address
+ */
+static const char*
+ParseAddress (const char *p, const char *end, uint32_t &address)
+{
+  address = 0;
+  for (int byte = 0; byte < 4; byte++)
+    {
+      uint32_t value;
+      if (byte > 0)
+        {
+          if (p == end || *p != '.')
+            {
+              return 0;
+            }
+          p++;
+        }
+      p = ParseNumber (p, end, value);
+      if (p == 0 || value > 255)
+        {
+          return 0;
+        }
+      address = (address << 8) | value;
+    }
+  return p;
+}
+
+/// Route dump keywords followed by one argument, skipped with it
+static const char * const g_valuedKeywords[] = {
+  "proto", "scope", "src", "table", "type", "mtu", "advmss", "expires", "pref", "realm", "realms",
+  "weight", "hoplimit", "tos", "dsfield", "nhid", "error", "initcwnd", "initrwnd", "rtt", "rttvar",
+  "rto_min", "window", "ssthresh", "cwnd", "reordering", "features", "quickack", "congctl",
+  "fastopen_no_cookie", 0
+};
+
+/// Route dump keywords standing alone, skipped
+static const char * const g_flagKeywords[] = {
+  "onlink", "linkdown", "dead", "pervasive", "offload", "trap", "notify",
+  "rt_offload", "rt_trap", "rt_offload_failed", 0
+};
+
+/**
+ * \brief Look a token up in a keyword list.
+ * \param token the token
+ * \param length the token length
+ * \param keywords the keywords, terminated by a null pointer
+ * \return true if the token is one of the keywords
+ */
+static bool
+IsKeyword (const char *token, uint32_t length, const char * const *keywords)
+{
+  for (; *keywords != 0; keywords++)
+    {
+      if (std::strlen (*keywords) == length && std::memcmp (token, *keywords, length) == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/**
+ * \brief Parse one line of a route dump.
+ * \param p start of the line
+ * \param end end of the line, without the newline
+ * \param spec set to the route; the interface is the ifindex of the dump
+ * \return false if the line is malformed
+ */
+static bool
+ParseRouteLine (const char *p, const char *end, PIORouteSpec &spec)
+{
+  const char *token;
+  uint32_t length;
+  uint32_t value;
+
+  if (!NextToken (p, end, token, length))
+    {
+      return false;
+    }
+  if (length == 7 && std::memcmp (token, "default", 7) == 0)
+    {
+      spec.network = Ipv4Address::GetZero ();
+      spec.networkMask = Ipv4Mask::GetZero ();
+    }
+  else
+    {
+      uint32_t network;
+      uint32_t prefixLength = 32;
+      const char *q = ParseAddress (token, token + length, network);
+      if (q == 0)
+        {
+          return false;
+        }
+      if (q != token + length)
+        {
+          if (*q != '/' || (q = ParseNumber (q + 1, token + length, prefixLength)) != token + length || prefixLength > 32)
+            {
+              return false;
+            }
+        }
+      uint32_t mask = prefixLength == 0 ? 0 : (0xffffffff << (32 - prefixLength));
+      spec.network = Ipv4Address (network & mask);
+      spec.networkMask = Ipv4Mask (mask);
+    }
+
+  bool dev = false;
+  spec.nextHop = Ipv4Address::GetZero ();
+  spec.metric = 0;
+  while (NextToken (p, end, token, length))
+    {
+      if (length == 3 && std::memcmp (token, "via", 3) == 0)
+        {
+          uint32_t gateway;
+          if (!NextToken (p, end, token, length) || ParseAddress (token, token + length, gateway) != token + length)
+            {
+              return false;
+            }
+          spec.nextHop = Ipv4Address (gateway);
+        }
+      else if (length == 3 && std::memcmp (token, "dev", 3) == 0)
+        {
+          if (!NextToken (p, end, token, length) || ParseNumber (token, token + length, value) != token + length)
+            {
+              return false;
+            }
+          spec.interface = value;
+          dev = true;
+        }
+      else if (ParseNumber (token, token + length, value) == token + length
+               || (length == 6 && std::memcmp (token, "metric", 6) == 0
+                   && NextToken (p, end, token, length) && ParseNumber (token, token + length, value) == token + length))
+        {
+          if (value > 0xffff)
+            {
+              return false;
+            }
+          spec.metric = value;
+        }
+      else if (IsKeyword (token, length, g_valuedKeywords))
+        {
+          // the argument may follow a "lock" modifier, as in "mtu lock 1400"
+          if (!NextToken (p, end, token, length)
+              || (length == 4 && std::memcmp (token, "lock", 4) == 0 && !NextToken (p, end, token, length)))
+            {
+              return false;
+            }
+        }
+      else if (!IsKeyword (token, length, g_flagKeywords))
+        {
+          // whether an unknown keyword takes an argument is not known
+          return false;
+        }
+    }
+  return dev;
+}
+
 PIOHelper::PIOHelper () : Ipv4RoutingHelper ()
                             
 {
@@ -55,6 +290,12 @@ PIOHelper::Create (Ptr<Node> node) const
 {
   Ptr<PIORoutingProtocol> PIORouteProto = m_factory.Create<PIORoutingProtocol> ();
 
+  std::map<Ptr<Node>, std::set<uint32_t> >::const_iterator it = m_interfaceExclusions.find (node);
+  if (it != m_interfaceExclusions.end ())
+    {
+      PIORouteProto->SetInterfaceExclusions (it->second);
+    }
+
   node->AggregateObject (PIORouteProto);
   return PIORouteProto;
 }
@@ -121,6 +362,266 @@ void PIOHelper::SetDefRoute (Ptr<Node> node, Ipv4Address nextHop, uint32_t inter
   }
 }
 
+uint32_t
+PIOHelper::AddRoutes (Ptr<Node> node, const std::vector<PIORouteSpec> &routes)
+{
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+  Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+  NS_ASSERT_MSG (PIO, "PIO routing not installed on node");
+
+  return PIO->AddRoutes (routes);
+}
+
+uint32_t
+PIOHelper::AddTable (Ptr<Node> node)
+{
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+  Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+  NS_ASSERT_MSG (PIO, "PIO routing not installed on node");
+
+  return PIO->AddTable ();
+}
+
+void
+PIOHelper::SetInterfaceTable (Ptr<Node> node, const std::set<uint32_t> &interfaces, uint32_t table)
+{
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+  Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+  NS_ASSERT_MSG (PIO, "PIO routing not installed on node");
+
+  for (std::set<uint32_t>::const_iterator interface = interfaces.begin (); interface != interfaces.end (); interface++)
+    {
+      PIO->SetInterfaceTable (*interface, table);
+    }
+}
+
+uint32_t
+PIOHelper::AddRoutes (Ptr<Node> node, uint32_t table, const std::vector<PIORouteSpec> &routes)
+{
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+  Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+  NS_ASSERT_MSG (PIO, "PIO routing not installed on node");
+
+  return PIO->AddRoutes (table, routes);
+}
+
+void
+PIOHelper::WriteSnapshot (std::string filename, NodeContainer nodes) const
+{
+  std::vector<PIOSnapshotRecord> records;
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4> ();
+      NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+      Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+      if (PIO)
+        {
+          PIO->SaveRoutes ((*i)->GetId (), records);
+        }
+    }
+
+  PIOSnapshotHeader header;
+  header.magic = PIOSnapshotHeader::MAGIC;
+  header.version = PIOSnapshotHeader::VERSION;
+  header.recordSize = sizeof (PIOSnapshotRecord);
+  header.reserved = 0;
+  header.nRecords = records.size ();
+
+  FILE *file = std::fopen (filename.c_str (), "wb");
+  NS_ABORT_MSG_IF (file == 0, "PIO: cannot open snapshot " << filename << ": " << std::strerror (errno));
+  bool written = std::fwrite (&header, sizeof (header), 1, file) == 1
+    && (records.empty () || std::fwrite (&records[0], sizeof (PIOSnapshotRecord), records.size (), file) == records.size ());
+  NS_ABORT_MSG_IF (std::fclose (file) != 0 || !written, "PIO: cannot write snapshot " << filename);
+}
+
+uint32_t
+PIOHelper::LoadSnapshot (std::string filename, NodeContainer nodes) const
+{
+  int fd = open (filename.c_str (), O_RDONLY);
+  NS_ABORT_MSG_IF (fd < 0, "PIO: cannot open snapshot " << filename << ": " << std::strerror (errno));
+
+  struct stat st;
+  NS_ABORT_MSG_IF (fstat (fd, &st) != 0 || uint64_t (st.st_size) < sizeof (PIOSnapshotHeader),
+                   "PIO: snapshot " << filename << " is truncated");
+
+  void *map = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  NS_ABORT_MSG_IF (map == MAP_FAILED, "PIO: cannot map snapshot " << filename << ": " << std::strerror (errno));
+
+  const PIOSnapshotHeader *header = static_cast<const PIOSnapshotHeader*> (map);
+  NS_ABORT_MSG_IF (!CheckSnapshot (map, st.st_size),
+                   "PIO: " << filename << " is not a complete PIO snapshot of this version and byte order");
+
+  std::map<uint32_t, Ptr<PIORoutingProtocol> > protocols;
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4> ();
+      NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+      Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+      if (PIO)
+        {
+          protocols[(*i)->GetId ()] = PIO;
+        }
+    }
+
+  // hand each run of records of the same node to its routing protocol
+  const PIOSnapshotRecord *records = reinterpret_cast<const PIOSnapshotRecord*> (header + 1);
+  const PIOSnapshotRecord *end = records + header->nRecords;
+  uint32_t added = 0;
+  while (records != end)
+    {
+      const PIOSnapshotRecord *run = records;
+      while (run != end && run->node == records->node)
+        {
+          run++;
+        }
+      std::map<uint32_t, Ptr<PIORoutingProtocol> >::const_iterator it = protocols.find (records->node);
+      if (it != protocols.end ())
+        {
+          added += it->second->LoadRoutes (records, run - records);
+        }
+      records = run;
+    }
+
+  munmap (map, st.st_size);
+  return added;
+}
+
+bool
+PIOHelper::CheckSnapshot (const void *data, uint64_t size)
+{
+  if (size < sizeof (PIOSnapshotHeader))
+    {
+      return false;
+    }
+  const PIOSnapshotHeader *header = static_cast<const PIOSnapshotHeader*> (data);
+  return header->magic == PIOSnapshotHeader::MAGIC && header->version == PIOSnapshotHeader::VERSION
+         && header->recordSize == sizeof (PIOSnapshotRecord)
+         && (size - sizeof (PIOSnapshotHeader)) / sizeof (PIOSnapshotRecord) >= header->nRecords;
+}
+
+uint32_t
+PIOHelper::LoadRouteDump (Ptr<Node> node, std::string filename,
+                          const std::map<uint32_t, uint32_t> &interfaces,
+                          Time timeoutTime, Time garbageCollectionTime)
+{
+  static const uint32_t CHUNK_SIZE = 1 << 20; // bytes read at once
+  static const uint32_t BATCH_SIZE = 1 << 16; // routes per AddRoutes call
+
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ipv4, "Ipv4 not installed on node");
+
+  Ptr<PIORoutingProtocol> PIO = GetPIORouting (ipv4);
+  NS_ASSERT_MSG (PIO, "PIO routing not installed on node");
+
+  FILE *file = std::fopen (filename.c_str (), "rb");
+  NS_ABORT_MSG_IF (file == 0, "PIO: cannot open route dump " << filename << ": " << std::strerror (errno));
+
+  std::vector<char> chunk (CHUNK_SIZE);
+  std::vector<PIORouteSpec> batch;
+  batch.reserve (BATCH_SIZE);
+
+  PIORouteSpec spec;
+  spec.sequenceNo = 0;
+  spec.timeoutTime = timeoutTime;
+  spec.garbageCollectionTime = garbageCollectionTime;
+
+  uint32_t added = 0;
+  uint32_t skipped = 0;
+  uint32_t used = 0; // bytes of an incomplete line kept at the start of the chunk
+  bool overlong = false; // dropping a line longer than a chunk
+  bool eof = false;
+
+  while (!eof)
+    {
+      size_t n = std::fread (&chunk[used], 1, CHUNK_SIZE - used, file);
+      eof = n < CHUNK_SIZE - used;
+      if (eof && used + n != 0 && chunk[used + n - 1] != '\n')
+        {
+          // terminate the last line
+          chunk[used + n] = '\n';
+          n++;
+        }
+      const char *p = &chunk[0];
+      const char *end = p + used + n;
+
+      const char *line;
+      while ((line = p) != end)
+        {
+          const char *newline = static_cast<const char*> (std::memchr (p, '\n', end - p));
+          if (newline == 0)
+            {
+              break;
+            }
+          p = newline + 1;
+
+          const char *first = SkipBlanks (line, newline);
+          if (overlong)
+            {
+              overlong = false;
+              continue;
+            }
+          if (first == newline || *first == '#')
+            {
+              continue;
+            }
+          if (!ParseRouteLine (first, newline, spec))
+            {
+              NS_LOG_WARN ("PIO: malformed line in " << filename << ": " << std::string (first, newline));
+              skipped++;
+              continue;
+            }
+          if (!interfaces.empty ())
+            {
+              std::map<uint32_t, uint32_t>::const_iterator it = interfaces.find (spec.interface);
+              if (it == interfaces.end ())
+                {
+                  skipped++;
+                  continue;
+                }
+              spec.interface = it->second;
+            }
+          batch.push_back (spec);
+          if (batch.size () == BATCH_SIZE)
+            {
+              added += PIO->AddRoutes (batch);
+              batch.clear ();
+            }
+        }
+
+      used = end - p;
+      if (used == CHUNK_SIZE)
+        {
+          NS_LOG_WARN ("PIO: line longer than " << CHUNK_SIZE << " bytes in " << filename);
+          skipped++;
+          overlong = true;
+          used = 0;
+        }
+      else if (used != 0)
+        {
+          std::memmove (&chunk[0], p, used);
+        }
+    }
+  std::fclose (file);
+
+  if (!batch.empty ())
+    {
+      added += PIO->AddRoutes (batch);
+    }
+  NS_LOG_LOGIC ("PIO: " << added << " routes installed from " << filename << ", " << skipped << " lines skipped");
+  return added;
+}
+
 Ptr<PIORoutingProtocol>
 PIOHelper::GetPIORouting (Ptr<Ipv4> ipv4) const
 {
@@ -92,6 +92,112 @@ public:
    */
   void SetDefRoute (Ptr<Node> node, Ipv4Address nextHop, uint32_t interface);
 
+  /**
+   * \brief Install a batch of routes on the PIO routing protocol of a node.
+   *
+   * See PIORoutingProtocol::AddRoutes.
+   *
+   * \param node the node
+   * \param routes the routes
+   * \returns the number of routes installed
+   */
+  uint32_t AddRoutes (Ptr<Node> node, const std::vector<PIORouteSpec> &routes);
+
+  /**
+   * \brief Add a routing table (VRF) to the PIO routing protocol of a node.
+   *
+   * See PIORoutingProtocol::AddTable.
+   *
+   * \param node the node
+   * \returns the identifier of the new table
+   */
+  uint32_t AddTable (Ptr<Node> node);
+
+  /**
+   * \brief Bind interfaces of a node to a routing table.
+   * \param node the node
+   * \param interfaces the interfaces
+   * \param table the table, 0 for the main table
+   */
+  void SetInterfaceTable (Ptr<Node> node, const std::set<uint32_t> &interfaces, uint32_t table);
+
+  /**
+   * \brief Install a batch of routes in a routing table of a node.
+   *
+   * See PIORoutingProtocol::AddRoutes (uint32_t, const std::vector<PIORouteSpec> &).
+   *
+   * \param node the node
+   * \param table the table
+   * \param routes the routes
+   * \returns the number of routes installed
+   */
+  uint32_t AddRoutes (Ptr<Node> node, uint32_t table, const std::vector<PIORouteSpec> &routes);
+
+  /**
+   * \brief Write the routing tables of nodes to a snapshot file.
+   *
+   * The file holds a PIOSnapshotHeader followed by the PIOSnapshotRecord of
+   * every valid route of the nodes, grouped by node.
+   *
+   * \param filename the snapshot file
+   * \param nodes the nodes
+   */
+  void WriteSnapshot (std::string filename, NodeContainer nodes) const;
+
+  /**
+   * \brief Install the routes of a snapshot file on nodes.
+   *
+   * The file is mapped in memory and each node builds its routing table
+   * straight from the mapped records (see PIORoutingProtocol::LoadRoutes).
+   * Records of nodes not in the container are skipped.
+   *
+   * \param filename the snapshot file
+   * \param nodes the nodes, matched to the records by node id
+   * \returns the number of routes installed
+   */
+  uint32_t LoadSnapshot (std::string filename, NodeContainer nodes) const;
+
+  /**
+   * \brief Check the contents of a snapshot file: magic number, version,
+   * record size, and number of records against the size of the file.
+   *
+   * LoadSnapshot aborts on a file failing this check.
+   *
+   * \param data the contents of the file
+   * \param size the size of the file, in bytes
+   * \returns true if the snapshot can be loaded
+   */
+  static bool CheckSnapshot (const void *data, uint64_t size);
+
+  /**
+   * \brief Install the routes of a plain-text route dump on a node.
+   *
+   * Each line reads "prefix/len [via gateway] dev ifindex [metric] metric",
+   * e.g. "10.1.0.0/16 via 192.168.0.1 dev 2 metric 3" or
+   * "10.1.0.0/16 via 192.168.0.1 dev 2 3"; "default" stands for 0.0.0.0/0.
+   * The other keywords of "ip route" output are skipped: those taking an
+   * argument ("proto", "scope", "src", "table", "mtu", ...) together with
+   * it, and flags ("onlink", "linkdown", "dead", ...) alone. A line holding
+   * any other keyword is malformed and skipped; empty lines and lines
+   * starting with '#' are ignored.
+   *
+   * The file is read in fixed-size chunks and the routes are handed to
+   * PIORoutingProtocol::AddRoutes in batches, so memory use does not depend
+   * on the size of the dump.
+   *
+   * \param node the node
+   * \param filename the route dump
+   * \param interfaces maps the ifindex of the dump to the node's interface
+   * index; when empty, the ifindex is used as is. Lines with an unmapped
+   * ifindex are skipped.
+   * \param timeoutTime time after which the routes expire, zero for never
+   * \param garbageCollectionTime time after which an expired route is removed
+   * \returns the number of routes installed
+   */
+  uint32_t LoadRouteDump (Ptr<Node> node, std::string filename,
+                          const std::map<uint32_t, uint32_t> &interfaces = std::map<uint32_t, uint32_t> (),
+                          Time timeoutTime = Seconds (0), Time garbageCollectionTime = Seconds (0));
+
   /**
    * \brief Exclude an interface from PIO protocol.
    *
@@ -0,0 +1,445 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+* Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2 as
+* published by the Free Software Foundation;
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+*/
+
+#include "pio-header.h"
+
+namespace ns3 {
+
+/// Version of the packed format
+static const uint8_t PIO_VERSION = 2;
+/// Size of the fixed part of the message
+static const uint32_t PIO_HEADER_SIZE = 4;
+/// Flag of an entry carrying a sequence number delta
+static const uint8_t PIO_RTE_SEQUENCE = 0x40;
+/// Flag of an entry carrying a metric delta
+static const uint8_t PIO_RTE_METRIC = 0x80;
+/// Mask of the prefix length of an entry
+static const uint8_t PIO_RTE_LENGTH = 0x3f;
+
+/**
+ * \param value a sequence number
+ * \param previous the previous sequence number
+ * \return the difference, zigzag encoded so that small negative ones stay small
+ */
+static uint16_t
+ZigZag16 (uint16_t value, uint16_t previous)
+{
+  int16_t delta = int16_t (value - previous);
+  return uint16_t (uint16_t (delta) << 1) ^ uint16_t (delta >> 15);
+}
+
+/**
+ * \param value a metric
+ * \param previous the previous metric
+ * \return the difference, zigzag encoded so that small negative ones stay small
+ */
+static uint32_t
+ZigZag32 (uint32_t value, uint32_t previous)
+{
+  int32_t delta = int32_t (value - previous);
+  return (uint32_t (delta) << 1) ^ uint32_t (delta >> 31);
+}
+
+/**
+ * \param value a zigzag encoded difference
+ * \return the difference, to be added modulo 2^32
+ */
+static uint32_t
+UnZigZag (uint32_t value)
+{
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+/**
+ * \param value a value
+ * \return the number of bytes of the value as a varint (7 bits per byte)
+ */
+static uint32_t
+VarintSize (uint32_t value)
+{
+  uint32_t size = 1;
+  while (value >= 0x80)
+    {
+      value >>= 7;
+      size++;
+    }
+  return size;
+}
+
+/**
+ * \param i buffer iterator, advanced past the varint
+ * \param value the value to write
+ */
+static void
+WriteVarint (Buffer::Iterator &i, uint32_t value)
+{
+  while (value >= 0x80)
+    {
+      i.WriteU8 (uint8_t (value | 0x80));
+      value >>= 7;
+    }
+  i.WriteU8 (uint8_t (value));
+}
+
+/**
+ * \param i buffer iterator, advanced past the varint
+ * \param value the value read
+ * \return false if the varint is truncated or too long
+ */
+static bool
+ReadVarint (Buffer::Iterator &i, uint32_t &value)
+{
+  value = 0;
+  for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+      if (i.GetRemainingSize () == 0)
+        {
+          return false;
+        }
+      uint8_t byte = i.ReadU8 ();
+      value |= uint32_t (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/**
+ * \param rte an entry
+ * \param previous the entry packed before it, or 0
+ * \return the size of the packed entry
+ */
+static uint32_t
+PackedSize (const PIORte &rte, const PIORte *previous)
+{
+  uint16_t sequenceNo = previous ? previous->GetSequenceNo () : 0;
+  uint32_t metric = previous ? previous->GetRouteMetric () : 0;
+
+  uint32_t size = 1 + (rte.GetSubnetMask ().GetPrefixLength () + 7) / 8;
+  if (rte.GetSequenceNo () != sequenceNo)
+    {
+      size += VarintSize (ZigZag16 (rte.GetSequenceNo (), sequenceNo));
+    }
+  if (rte.GetRouteMetric () != metric)
+    {
+      size += VarintSize (ZigZag32 (rte.GetRouteMetric (), metric));
+    }
+  return size;
+}
+
+
+/*
+* PIORte
+*/
+PIORte::PIORte () : m_prefix ("127.0.0.1"),
+                    m_subnetMask ("0.0.0.0"),
+                    m_sequenceNo (0),
+                    m_metric (16)
+{
+  /*cstrctr*/
+}
+
+void
+PIORte::Print (std::ostream & os) const
+{
+  os << "prefix " << m_prefix << "/" << int (m_subnetMask.GetPrefixLength ()) << " Metric " << int (m_metric) << " Seq " << int (m_sequenceNo);
+}
+
+void
+PIORte::SetPrefix (Ipv4Address prefix)
+{
+  m_prefix = prefix;
+}
+
+Ipv4Address
+PIORte::GetPrefix () const
+{
+  return m_prefix;
+}
+
+void
+PIORte::SetSubnetMask (Ipv4Mask subnetMask)
+{
+  m_subnetMask = subnetMask;
+}
+
+Ipv4Mask
+PIORte::GetSubnetMask () const
+{
+  return m_subnetMask;
+}
+
+void
+PIORte::SetSequenceNo (uint16_t sequenceNo)
+{
+  m_sequenceNo = sequenceNo;
+}
+
+uint16_t
+PIORte::GetSequenceNo () const
+{
+  return m_sequenceNo;
+}
+
+void
+PIORte::SetRouteMetric (uint32_t routeMetric)
+{
+  m_metric = routeMetric;
+}
+
+uint32_t
+PIORte::GetRouteMetric () const
+{
+  return m_metric;
+}
+
+std::ostream & operator << (std::ostream & os, const PIORte & h)
+{
+  h.Print (os);
+  return os;
+}
+
+/*
+* PIOHeader
+*/
+NS_OBJECT_ENSURE_REGISTERED (PIOHeader);
+
+PIOHeader::PIOHeader () : m_command (0),
+                          m_size (PIO_HEADER_SIZE)
+{
+  /*cstrctr*/
+}
+
+TypeId
+PIOHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PIOHeader")
+    .SetParent<Header> ()
+    .AddConstructor<PIOHeader> ();
+  return tid;
+}
+
+TypeId
+PIOHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+PIOHeader::Print (std::ostream & os) const
+{
+  os << "command " << int (m_command);
+  for (std::vector<PIORte>::const_iterator iter = m_rteList.begin (); iter != m_rteList.end (); iter++)
+    {
+      os << " | ";
+      iter->Print (os);
+    }
+}
+
+uint32_t
+PIOHeader::GetSerializedSize () const
+{
+  return m_size;
+}
+
+void
+PIOHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+
+  i.WriteU8 (uint8_t (m_command));
+  i.WriteU8 (PIO_VERSION);
+  i.WriteHtonU16 (m_rteList.size ());
+
+  uint16_t sequenceNo = 0;
+  uint32_t metric = 0;
+  for (std::vector<PIORte>::const_iterator iter = m_rteList.begin (); iter != m_rteList.end (); iter++)
+    {
+      uint8_t length = iter->GetSubnetMask ().GetPrefixLength ();
+      uint8_t flags = length;
+      if (iter->GetSequenceNo () != sequenceNo)
+        {
+          flags |= PIO_RTE_SEQUENCE;
+        }
+      if (iter->GetRouteMetric () != metric)
+        {
+          flags |= PIO_RTE_METRIC;
+        }
+      i.WriteU8 (flags);
+
+      uint32_t prefix = iter->GetPrefix ().Get ();
+      for (uint8_t n = 0; n < (length + 7) / 8; n++)
+        {
+          i.WriteU8 (uint8_t (prefix >> (24 - 8 * n)));
+        }
+
+      if (flags & PIO_RTE_SEQUENCE)
+        {
+          WriteVarint (i, ZigZag16 (iter->GetSequenceNo (), sequenceNo));
+          sequenceNo = iter->GetSequenceNo ();
+        }
+      if (flags & PIO_RTE_METRIC)
+        {
+          WriteVarint (i, ZigZag32 (iter->GetRouteMetric (), metric));
+          metric = iter->GetRouteMetric ();
+        }
+    }
+}
+
+uint32_t
+PIOHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+
+  // nothing of a previous message survives a rejected one
+  m_command = 0;
+  ClearRtes ();
+  if (i.GetRemainingSize () < PIO_HEADER_SIZE)
+    {
+      return 0;
+    }
+
+  uint8_t temp;
+  temp = i.ReadU8 ();
+  if ((temp == REQUEST) || (temp == RESPONSE) || (temp == KEEP_ALIVE) || (temp == PROBE))
+    {
+      m_command = temp;
+    }
+  else
+    {
+      return 0;
+    }
+
+  if (i.ReadU8 () != PIO_VERSION)
+    {
+      return 0;
+    }
+  uint16_t rteNumber = i.ReadNtohU16 ();
+
+  PIORte rte;
+  rte.SetSequenceNo (0);
+  rte.SetRouteMetric (0);
+  for (uint16_t n = 0; n < rteNumber && i.GetRemainingSize () > 0; n++)
+    {
+      Buffer::Iterator entry = i;
+      uint8_t flags = i.ReadU8 ();
+      uint8_t length = flags & PIO_RTE_LENGTH;
+      if (length > 32 || i.GetRemainingSize () < uint32_t (length + 7) / 8)
+        {
+          i = entry;
+          break;
+        }
+
+      uint32_t prefix = 0;
+      for (uint8_t b = 0; b < (length + 7) / 8; b++)
+        {
+          prefix |= uint32_t (i.ReadU8 ()) << (24 - 8 * b);
+        }
+      Ipv4Mask mask (length == 0 ? 0 : 0xffffffff << (32 - length));
+      rte.SetPrefix (Ipv4Address (prefix & mask.Get ()));
+      rte.SetSubnetMask (mask);
+
+      uint32_t delta;
+      if (flags & PIO_RTE_SEQUENCE)
+        {
+          if (!ReadVarint (i, delta))
+            {
+              i = entry;
+              break;
+            }
+          rte.SetSequenceNo (rte.GetSequenceNo () + UnZigZag (delta));
+        }
+      if (flags & PIO_RTE_METRIC)
+        {
+          if (!ReadVarint (i, delta))
+            {
+              i = entry;
+              break;
+            }
+          rte.SetRouteMetric (rte.GetRouteMetric () + UnZigZag (delta));
+        }
+
+      m_rteList.push_back (rte);
+      m_size += i.GetDistanceFrom (entry);
+    }
+
+  return i.GetDistanceFrom (start);
+}
+
+void
+PIOHeader::SetCommand (PIOHeader::Command_e command)
+{
+  m_command = command;
+}
+
+PIOHeader::Command_e
+PIOHeader::GetCommand () const
+{
+  return PIOHeader::Command_e (m_command);
+}
+
+void
+PIOHeader::AddRte (const PIORte &rte)
+{
+  m_size += GetRteSize (rte);
+  m_rteList.push_back (rte);
+}
+
+void
+PIOHeader::ClearRtes ()
+{
+  m_rteList.clear ();
+  m_size = PIO_HEADER_SIZE;
+}
+
+uint16_t
+PIOHeader::GetRteNumber (void) const
+{
+  return m_rteList.size ();
+}
+
+const std::vector<PIORte> &
+PIOHeader::GetRteList (void) const
+{
+  return m_rteList;
+}
+
+uint32_t
+PIOHeader::GetRteSize (const PIORte &rte) const
+{
+  return PackedSize (rte, m_rteList.empty () ? 0 : &m_rteList.back ());
+}
+
+uint32_t
+PIOHeader::GetMaxSize (uint16_t mtu)
+{
+  // IPv4 header (20) and UDP header (8)
+  return mtu - 20 - 8;
+}
+
+std::ostream & operator << (std::ostream & os, const PIOHeader & h)
+{
+  h.Print (os);
+  return os;
+}
+
+}
@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_HEADER_H
+#define PIO_HEADER_H
+
+#include <vector>
+
+#include "ns3/header.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief PIO Routing Table Entry (RTE): a prefix with its sequence number and
+ * metric.
+ *
+ * An RTE has no wire format of its own: it is packed by PIOHeader relative
+ * to the previous RTE of the message.
+ */
+class PIORte
+{
+public:
+  PIORte (void);
+
+  /**
+   * \brief Print the RTE.
+   * \param os the output stream
+   */
+  void Print (std::ostream& os) const;
+
+  /**
+   * \brief Set the prefix
+   * \param prefix the prefix
+   */
+  void SetPrefix (Ipv4Address prefix);
+
+  /**
+   * \brief Get the prefix
+   * \returns the prefix
+   */
+  Ipv4Address GetPrefix (void) const;
+
+  /**
+   * \brief Set the subnet mask
+   * \param subnetMask the subnet mask
+   */
+  void SetSubnetMask (Ipv4Mask subnetMask);
+
+  /**
+   * \brief Get the subnet mask
+   * \returns the subnet mask
+   */
+  Ipv4Mask GetSubnetMask (void) const;
+
+  /**
+   * \brief Set the sequence number
+   * \param sequenceNo the sequence number
+   */
+  void SetSequenceNo (uint16_t sequenceNo);
+
+  /**
+   * \brief Get the sequence number
+   * \returns the sequence number
+   */
+  uint16_t GetSequenceNo (void) const;
+
+  /**
+   * \brief Set the route metric
+   * \param routeMetric the route metric
+   */
+  void SetRouteMetric (uint32_t routeMetric);
+
+  /**
+   * \brief Get the route metric
+   * \returns the route metric
+   */
+  uint32_t GetRouteMetric (void) const;
+
+private:
+  Ipv4Address m_prefix; //!< prefix
+  Ipv4Mask m_subnetMask; //!< subnet mask
+  uint16_t m_sequenceNo; //!< sequence number of the route
+  uint32_t m_metric; //!< route metric
+};
+
+/**
+ * \brief Stream insertion operator.
+ *
+ * \param os the reference to the output stream
+ * \param h the Routing Table Entry
+ * \returns the reference to the output stream
+ */
+std::ostream & operator << (std::ostream & os, const PIORte & h);
+
+/**
+ * \ingroup PIO
+ * \brief PIO message header: a command followed by packed route table entries.
+ *
+ * Keep-alives and fast failure detection probes have no entries.
+ *
+ * \verbatim
+    0                   1                   2                   3
+    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |  command (1)  |  version (1)  |     number of entries (2)     |
+   +---------------+---------------+-------------------------------+
+   |                                                               |
+   ~                   PIO Route Table Entries                     ~
+   |                                                               |
+   +---------------+---------------+---------------+---------------+
+   \endverbatim
+ *
+ * Each entry is packed as:
+ *
+ * \verbatim
+   +-+-+-----------+----------------------+-------------+-----------+
+   |M|S| length(6) | prefix (0 to 4)      | seq delta   | met delta |
+   +-+-+-----------+----------------------+-------------+-----------+
+   \endverbatim
+ *
+ * - length is the prefix length, and only the ceil(length / 8) significant
+ *   bytes of the prefix are sent;
+ * - the sequence number and the metric are sent as the difference from the
+ *   ones of the previous entry (zero for the first entry), zigzag and
+ *   varint encoded, and only if S (resp. M) is set, i.e., if they differ.
+ *
+ * A /24 with the same sequence number and metric as the previous entry
+ * takes 4 bytes instead of the 20 bytes of a RIPv2 entry.
+ *
+ * The entries are kept in a vector which is only cleared, never shrunk, so a
+ * header reused across messages serializes and deserializes without
+ * allocating once it has grown to the largest message.
+ */
+class PIOHeader : public Header
+{
+public:
+  PIOHeader (void);
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Return the instance type identifier.
+   * \return instance type ID
+   */
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual void Print (std::ostream& os) const;
+
+  /**
+   * \brief Get the serialized size of the packet.
+   * \return size
+   */
+  virtual uint32_t GetSerializedSize (void) const;
+
+  /**
+   * \brief Serialize the packet.
+   * \param start Buffer iterator
+   */
+  virtual void Serialize (Buffer::Iterator start) const;
+
+  /**
+   * \brief Deserialize the packet.
+   *
+   * Decoding stops at the first truncated or malformed entry.
+   *
+   * \param start Buffer iterator
+   * \return size of the packet
+   */
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /**
+   * Commands to be used in the header
+   */
+  enum Command_e
+  {
+    REQUEST = 0x1,
+    RESPONSE = 0x2,
+    KEEP_ALIVE = 0x3,
+    PROBE = 0x4,
+  };
+
+  /**
+   * \brief Set the command
+   * \param command the command
+   */
+  void SetCommand (Command_e command);
+
+  /**
+   * \brief Get the command
+   * \returns the command
+   */
+  Command_e GetCommand (void) const;
+
+  /**
+   * \brief Add a RTE to the message
+   * \param rte the RTE
+   */
+  void AddRte (const PIORte &rte);
+
+  /**
+   * \brief Clear all the RTEs from the header
+   */
+  void ClearRtes ();
+
+  /**
+   * \brief Get the number of RTE included in the message
+   * \returns the number of RTE in the message
+   */
+  uint16_t GetRteNumber (void) const;
+
+  /**
+   * \brief Get the list of the RTEs included in the message
+   * \returns the list of the RTEs in the message
+   */
+  const std::vector<PIORte> & GetRteList (void) const;
+
+  /**
+   * \param rte a RTE
+   * \return the number of bytes the RTE would take if added to the message
+   */
+  uint32_t GetRteSize (const PIORte &rte) const;
+
+  /**
+   * \param mtu MTU of the interface the message is sent on
+   * \return the largest message fitting in a datagram sent over UDP
+   */
+  static uint32_t GetMaxSize (uint16_t mtu);
+
+private:
+  uint8_t m_command; //!< command type
+  std::vector<PIORte> m_rteList; //!< list of the RTEs in the message
+  uint32_t m_size; //!< serialized size of the message
+};
+
+/**
+ * \brief Stream insertion operator.
+ *
+ * \param os the reference to the output stream
+ * \param h the PIO header
+ * \returns the reference to the output stream
+ */
+std::ostream & operator << (std::ostream & os, const PIOHeader & h);
+
+}
+
+#endif /* PIO_HEADER_H */
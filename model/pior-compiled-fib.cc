@@ -0,0 +1,186 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+* Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2 as
+* published by the Free Software Foundation;
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+*/
+
+#include "pior-compiled-fib.h"
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+const uint32_t PIOCompiledFib::NONE;
+
+PIOCompiledFib::PIOCompiledFib ()
+{
+  Clear ();
+}
+
+void
+PIOCompiledFib::Clear (void)
+{
+  std::vector<uint32_t> ().swap (m_tbl24);
+  std::vector<uint32_t> ().swap (m_tbl8);
+  m_records.clear ();
+  m_freeRecords.clear ();
+  m_prefixes.clear ();
+
+  Record none;
+  none.group = NONE;
+  none.length = 0;
+  none.paths = 0;
+  m_records.push_back (none);
+}
+
+uint32_t
+PIOCompiledFib::Set (Ipv4Address network, uint8_t length, uint32_t group, const PIORouteTrie::PathList *paths)
+{
+  NS_ASSERT (length <= 32 && group != NONE);
+
+  uint32_t prefix = network.Get () & MaskOf (length);
+  std::map<uint64_t, uint32_t>::iterator it = m_prefixes.find (Key (prefix, length));
+
+  if (it != m_prefixes.end ())
+    {
+      // the slots already refer to the record of the prefix
+      uint32_t previous = m_records[it->second].group;
+      m_records[it->second].group = group;
+      m_records[it->second].paths = paths;
+      return previous;
+    }
+
+  if (m_tbl24.empty ())
+    {
+      m_tbl24.assign (1 << 24, 0);
+    }
+
+  uint32_t record;
+  if (m_freeRecords.empty ())
+    {
+      record = m_records.size ();
+      m_records.push_back (Record ());
+    }
+  else
+    {
+      record = m_freeRecords.back ();
+      m_freeRecords.pop_back ();
+    }
+  m_records[record].group = group;
+  m_records[record].length = length;
+  m_records[record].paths = paths;
+  m_prefixes.insert (std::make_pair (Key (prefix, length), record));
+
+  Fill (prefix, length, record, 0);
+  return NONE;
+}
+
+uint32_t
+PIOCompiledFib::Unset (Ipv4Address network, uint8_t length)
+{
+  uint32_t prefix = network.Get () & MaskOf (length);
+  std::map<uint64_t, uint32_t>::iterator it = m_prefixes.find (Key (prefix, length));
+
+  if (it == m_prefixes.end ())
+    {
+      return NONE;
+    }
+
+  uint32_t record = it->second;
+  m_prefixes.erase (it);
+
+  // the covered slots fall back to the next shorter installed prefix
+  uint32_t cover = 0;
+  for (int coverLength = int (length) - 1; coverLength >= 0 && cover == 0; coverLength--)
+    {
+      std::map<uint64_t, uint32_t>::const_iterator coverIt = m_prefixes.find (Key (prefix & MaskOf (coverLength), coverLength));
+      if (coverIt != m_prefixes.end ())
+        {
+          cover = coverIt->second;
+        }
+    }
+
+  Fill (prefix, length, cover, record);
+
+  uint32_t group = m_records[record].group;
+  m_records[record].group = NONE;
+  m_records[record].paths = 0;
+  m_freeRecords.push_back (record);
+  return group;
+}
+
+void
+PIOCompiledFib::Fill (uint32_t network, uint8_t length, uint32_t record, uint32_t replaced)
+{
+  if (length <= 24)
+    {
+      uint32_t first = network >> 8;
+      uint32_t last = first + (1 << (24 - length));
+
+      for (uint32_t i = first; i < last; i++)
+        {
+          uint32_t &slot = m_tbl24[i];
+          if (slot & TBL8_FLAG)
+            {
+              uint32_t *group = &m_tbl8[(slot & ~TBL8_FLAG) << 8];
+              for (uint32_t j = 0; j < 256; j++)
+                {
+                  FillSlot (group[j], length, record, replaced);
+                }
+            }
+          else
+            {
+              FillSlot (slot, length, record, replaced);
+            }
+        }
+      return;
+    }
+
+  uint32_t &slot = m_tbl24[network >> 8];
+  if (!(slot & TBL8_FLAG))
+    {
+      // expand the /24 into a tbl8 group inheriting the current slot value
+      NS_ASSERT (replaced == 0);
+      uint32_t group = m_tbl8.size () >> 8;
+      m_tbl8.resize (m_tbl8.size () + 256, slot);
+      slot = group | TBL8_FLAG;
+    }
+
+  uint32_t *group = &m_tbl8[(slot & ~TBL8_FLAG) << 8];
+  uint32_t first = network & 0xff;
+  uint32_t last = first + (1 << (32 - length));
+  for (uint32_t j = first; j < last; j++)
+    {
+      FillSlot (group[j], length, record, replaced);
+    }
+}
+
+uint32_t
+PIOCompiledFib::GetNPrefixes (void) const
+{
+  return m_prefixes.size ();
+}
+
+uint64_t
+PIOCompiledFib::GetMemoryUsage (void) const
+{
+  return uint64_t (m_tbl24.capacity ()) * sizeof (uint32_t)
+    + uint64_t (m_tbl8.capacity ()) * sizeof (uint32_t)
+    + uint64_t (m_records.capacity ()) * sizeof (Record);
+}
+
+}
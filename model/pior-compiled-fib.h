@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_COMPILED_FIB_H
+#define PIO_COMPILED_FIB_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/ipv4-address.h"
+
+#include "pior-route-trie.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief DIR-24-8 compiled forwarding table.
+ *
+ * The first level (tbl24) has one slot per /24 network. A slot holds either
+ * the forwarding record of the longest prefix covering the whole /24, or the
+ * index of a 256-slot second level group (tbl8) used when prefixes longer
+ * than 24 bits fall inside that /24. A lookup costs one or two array reads.
+ *
+ * Each installed prefix owns one forwarding record holding the next-hop
+ * group used for that prefix (see PIONextHopTable) and the routes of the
+ * members of that group, kept by the route trie. Changing the group of a
+ * prefix only rewrites its record; adding or withdrawing a prefix rewrites
+ * the slots it covers.
+ *
+ * The first level is allocated on first use and takes 64 MiB.
+ */
+class PIOCompiledFib
+{
+public:
+  static const uint32_t NONE = 0xffffffff; //!< no group
+
+  PIOCompiledFib ();
+
+  /**
+   * \brief Install or update the next-hop group used for a prefix.
+   * \param network network address
+   * \param length prefix length
+   * \param group next-hop group of the prefix
+   * \param paths routes of the members of the group, in member order (see
+   * PIORouteTrie::GetPaths)
+   * \return the group the prefix used so far, or NONE if it was not installed
+   */
+  uint32_t Set (Ipv4Address network, uint8_t length, uint32_t group, const PIORouteTrie::PathList *paths);
+
+  /**
+   * \brief Withdraw a prefix. The slots it covered fall back to the next
+   * shorter installed prefix, if any. Does nothing if the prefix is not
+   * installed.
+   * \param network network address
+   * \param length prefix length
+   * \return the group the prefix used, or NONE if it was not installed
+   */
+  uint32_t Unset (Ipv4Address network, uint8_t length);
+
+  /**
+   * \brief Withdraw every prefix and release the tables.
+   */
+  void Clear (void);
+
+  /**
+   * \param address destination address
+   * \param length set to the length of the prefix found
+   * \param paths set to the routes of the members of the group found
+   * \return the group of the longest installed prefix covering the address, or NONE
+   */
+  uint32_t Lookup (Ipv4Address address, uint8_t &length, const PIORouteTrie::PathList* &paths) const
+  {
+    if (m_tbl24.empty ())
+      {
+        return NONE;
+      }
+    uint32_t key = address.Get ();
+    uint32_t slot = m_tbl24[key >> 8];
+    if (slot & TBL8_FLAG)
+      {
+        slot = m_tbl8[((slot & ~TBL8_FLAG) << 8) | (key & 0xff)];
+      }
+    length = m_records[slot].length;
+    paths = m_records[slot].paths;
+    return m_records[slot].group;
+  }
+
+  /**
+   * \return the number of installed prefixes
+   */
+  uint32_t GetNPrefixes (void) const;
+
+  /**
+   * \return the memory used by the tables, in bytes
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  static const uint32_t TBL8_FLAG = 0x80000000; //!< the slot refers to a tbl8 group
+
+  /// Forwarding record of an installed prefix
+  struct Record
+  {
+    uint32_t group; //!< next-hop group of the prefix
+    uint8_t length; //!< prefix length
+    const PIORouteTrie::PathList *paths; //!< routes of the members of the group
+  };
+
+  /**
+   * \param network network address
+   * \param length prefix length
+   * \return the key of the prefix in the record map
+   */
+  static uint64_t Key (uint32_t network, uint8_t length)
+  {
+    return (uint64_t (network) << 8) | length;
+  }
+
+  /**
+   * \param length prefix length
+   * \return the network mask of the given length
+   */
+  static uint32_t MaskOf (uint8_t length)
+  {
+    return length == 0 ? 0 : (0xffffffff << (32 - length));
+  }
+
+  /**
+   * \brief Write a record in the slots covered by a prefix.
+   *
+   * If replaced is zero, the slots currently holding a shorter prefix (or
+   * nothing) are overwritten. Otherwise, only the slots holding the record
+   * replaced are overwritten.
+   *
+   * \param network network address
+   * \param length prefix length
+   * \param record record to write
+   * \param replaced record to replace, or zero
+   */
+  void Fill (uint32_t network, uint8_t length, uint32_t record, uint32_t replaced);
+
+  /**
+   * \brief Write a record in one slot if it satisfies the Fill condition.
+   * \param slot the slot
+   * \param length prefix length of the record
+   * \param record record to write
+   * \param replaced record to replace, or zero
+   */
+  void FillSlot (uint32_t &slot, uint8_t length, uint32_t record, uint32_t replaced)
+  {
+    if (replaced != 0 ? (slot == replaced) : (slot == 0 || m_records[slot].length < length))
+      {
+        slot = record;
+      }
+  }
+
+  std::vector<uint32_t> m_tbl24; //!< first level, indexed by the 24 most significant bits
+  std::vector<uint32_t> m_tbl8; //!< second level groups of 256 slots
+  std::vector<Record> m_records; //!< forwarding records, record 0 means no route
+  std::vector<uint32_t> m_freeRecords; //!< released forwarding records
+  std::map<uint64_t, uint32_t> m_prefixes; //!< installed prefixes and their record
+};
+
+}
+#endif /* PIO_COMPILED_FIB_H */
@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+* Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2 as
+* published by the Free Software Foundation;
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+*/
+
+#include <algorithm>
+
+#include "pior-next-hop.h"
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+const uint32_t PIONextHopTable::NONE;
+
+PIONextHopTable::PIONextHopTable ()
+{
+  /*cstrctr*/
+}
+
+uint32_t
+PIONextHopTable::AddNextHop (Ipv4Address gateway, uint32_t interface, bool interfaceUp)
+{
+  NextHopKey key (gateway.Get (), interface);
+  std::map<NextHopKey, uint32_t>::iterator it = m_nextHopIds.find (key);
+  if (it != m_nextHopIds.end ())
+    {
+      m_nextHops[it->second].refs++;
+      return it->second;
+    }
+
+  uint32_t id;
+  if (m_freeNextHops.empty ())
+    {
+      id = m_nextHops.size ();
+      m_nextHops.push_back (NextHop ());
+    }
+  else
+    {
+      id = m_freeNextHops.back ();
+      m_freeNextHops.pop_back ();
+    }
+
+  NextHop &nextHop = m_nextHops[id];
+  nextHop.gateway = gateway;
+  nextHop.interface = interface;
+  nextHop.gatewayUp = true;
+  nextHop.interfaceUp = interfaceUp;
+  nextHop.refs = 1;
+  nextHop.groups.clear ();
+  m_nextHopIds.insert (std::make_pair (key, id));
+  m_interfaceNextHops[interface].push_back (id);
+  return id;
+}
+
+void
+PIONextHopTable::ReleaseNextHop (uint32_t id)
+{
+  NS_ASSERT (id < m_nextHops.size () && m_nextHops[id].refs > 0);
+
+  NextHop &nextHop = m_nextHops[id];
+  if (--nextHop.refs == 0)
+    {
+      NS_ASSERT (nextHop.groups.empty ());
+      m_nextHopIds.erase (NextHopKey (nextHop.gateway.Get (), nextHop.interface));
+      std::map<uint32_t, std::vector<uint32_t> >::iterator interface = m_interfaceNextHops.find (nextHop.interface);
+      std::vector<uint32_t> &ids = interface->second;
+      *std::find (ids.begin (), ids.end (), id) = ids.back ();
+      ids.pop_back ();
+      if (ids.empty ())
+        {
+          m_interfaceNextHops.erase (interface);
+        }
+      m_freeNextHops.push_back (id);
+    }
+}
+
+bool
+PIONextHopTable::SetGatewayState (Ipv4Address gateway, bool up)
+{
+  bool changed = false;
+
+  // the next hops of a gateway are contiguous in the (gateway, interface) map
+  std::map<NextHopKey, uint32_t>::const_iterator it = m_nextHopIds.lower_bound (NextHopKey (gateway.Get (), 0));
+  for (; it != m_nextHopIds.end () && it->first.first == gateway.Get (); it++)
+    {
+      NextHop &nextHop = m_nextHops[it->second];
+      if (nextHop.gatewayUp != up)
+        {
+          nextHop.gatewayUp = up;
+          UpdateNextHop (it->second);
+          changed = true;
+        }
+    }
+  return changed;
+}
+
+bool
+PIONextHopTable::SetInterfaceState (uint32_t interface, bool up)
+{
+  bool changed = false;
+
+  std::map<uint32_t, std::vector<uint32_t> >::const_iterator it = m_interfaceNextHops.find (interface);
+  if (it == m_interfaceNextHops.end ())
+    {
+      return false;
+    }
+  for (std::vector<uint32_t>::const_iterator id = it->second.begin (); id != it->second.end (); id++)
+    {
+      NextHop &nextHop = m_nextHops[*id];
+      if (nextHop.interfaceUp != up)
+        {
+          nextHop.interfaceUp = up;
+          UpdateNextHop (*id);
+          changed = true;
+        }
+    }
+  return changed;
+}
+
+uint32_t
+PIONextHopTable::AddGroup (const std::vector<Member> &members)
+{
+  std::map<std::vector<Member>, uint32_t>::iterator it = m_groupIds.find (members);
+  if (it != m_groupIds.end ())
+    {
+      m_groups[it->second].refs++;
+      return it->second;
+    }
+
+  uint32_t id;
+  if (m_freeGroups.empty ())
+    {
+      id = m_groups.size ();
+      m_groups.push_back (Group ());
+    }
+  else
+    {
+      id = m_freeGroups.back ();
+      m_freeGroups.pop_back ();
+    }
+
+  Group &group = m_groups[id];
+  group.members = members;
+  group.refs = 1;
+  for (std::vector<Member>::const_iterator member = members.begin (); member != members.end (); member++)
+    {
+      NS_ASSERT (member->nextHop < m_nextHops.size () && m_nextHops[member->nextHop].refs > 0);
+      m_nextHops[member->nextHop].refs++;
+      std::vector<uint32_t> &groups = m_nextHops[member->nextHop].groups;
+      if (std::find (groups.begin (), groups.end (), id) == groups.end ())
+        {
+          groups.push_back (id);
+        }
+    }
+  m_groupIds.insert (std::make_pair (members, id));
+  UpdateGroup (id);
+  return id;
+}
+
+void
+PIONextHopTable::ReleaseGroup (uint32_t id)
+{
+  NS_ASSERT (id < m_groups.size () && m_groups[id].refs > 0);
+
+  Group &group = m_groups[id];
+  if (--group.refs > 0)
+    {
+      return;
+    }
+
+  m_groupIds.erase (group.members);
+  for (std::vector<Member>::const_iterator member = group.members.begin (); member != group.members.end (); member++)
+    {
+      std::vector<uint32_t> &groups = m_nextHops[member->nextHop].groups;
+      std::vector<uint32_t>::iterator it = std::find (groups.begin (), groups.end (), id);
+      if (it != groups.end ())
+        {
+          *it = groups.back ();
+          groups.pop_back ();
+        }
+      ReleaseNextHop (member->nextHop);
+    }
+  group.members.clear ();
+  group.active.clear ();
+  m_freeGroups.push_back (id);
+}
+
+void
+PIONextHopTable::UpdateGroup (uint32_t id)
+{
+  Group &group = m_groups[id];
+  group.active.clear ();
+  uint16_t metric = 0;
+  uint32_t failed = 0xffffffff;
+  for (std::vector<Member>::const_iterator member = group.members.begin (); member != group.members.end (); member++)
+    {
+      if (!IsUsable (member->nextHop))
+        {
+          failed = std::min<uint32_t> (failed, member->metric);
+          continue;
+        }
+      if (!group.active.empty () && member->metric < metric)
+        {
+          group.active.clear ();
+        }
+      if (group.active.empty () || member->metric == metric)
+        {
+          metric = member->metric;
+          group.active.push_back (member - group.members.begin ());
+        }
+    }
+
+  if (!group.active.empty () && !IsLoopFree (metric, failed))
+    {
+      group.active.clear ();
+    }
+}
+
+void
+PIONextHopTable::UpdateNextHop (uint32_t id)
+{
+  const std::vector<uint32_t> &groups = m_nextHops[id].groups;
+  for (std::vector<uint32_t>::const_iterator it = groups.begin (); it != groups.end (); it++)
+    {
+      UpdateGroup (*it);
+    }
+}
+
+void
+PIONextHopTable::Clear (void)
+{
+  m_nextHops.clear ();
+  m_freeNextHops.clear ();
+  m_nextHopIds.clear ();
+  m_interfaceNextHops.clear ();
+  m_groups.clear ();
+  m_freeGroups.clear ();
+  m_groupIds.clear ();
+}
+
+uint32_t
+PIONextHopTable::GetNNextHops (void) const
+{
+  return m_nextHopIds.size ();
+}
+
+uint32_t
+PIONextHopTable::GetNGroups (void) const
+{
+  return m_groupIds.size ();
+}
+
+}
@@ -0,0 +1,256 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_NEXT_HOP_H
+#define PIO_NEXT_HOP_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief Shared next hops and next-hop groups of a routing protocol.
+ *
+ * A next hop is a (gateway, interface) pair, shared by every route using it.
+ * It is usable while both its gateway and its interface are up.
+ *
+ * A next-hop group is the ordered list of the next hops of a prefix with
+ * their metric: the usable next hops having the lowest metric are the
+ * active ones, the others are precomputed backups. A backup only takes over
+ * from failed next hops if it is a loop-free alternate (see IsLoopFree).
+ * Prefixes with the same list share the same group.
+ *
+ * When a gateway or an interface changes state, only the next hops using it
+ * and the groups using those next hops are updated, so every dependent
+ * prefix is redirected in a time that does not depend on the number of
+ * prefixes (prefix-independent convergence).
+ *
+ * Next hops and groups are reference counted and identified by an index.
+ */
+class PIONextHopTable
+{
+public:
+  static const uint32_t NONE = 0xffffffff; //!< identifier of no next hop or group
+
+  /// Member of a next-hop group
+  struct Member
+  {
+    uint32_t nextHop; //!< next hop identifier
+    uint16_t metric; //!< metric of the route through the next hop
+
+    /**
+     * \param other another member
+     * \return true if this member sorts before the other one
+     */
+    bool operator< (const Member &other) const
+    {
+      return nextHop < other.nextHop || (nextHop == other.nextHop && metric < other.metric);
+    }
+  };
+
+  PIONextHopTable ();
+
+  /**
+   * \brief Get a reference to the next hop of a (gateway, interface) pair,
+   * creating it if needed.
+   * \param gateway gateway address, zero for a directly connected network
+   * \param interface interface index
+   * \param interfaceUp state of the interface, used if the next hop is created
+   * \return the next hop identifier
+   */
+  uint32_t AddNextHop (Ipv4Address gateway, uint32_t interface, bool interfaceUp);
+
+  /**
+   * \brief Drop a reference to a next hop.
+   * \param id next hop identifier
+   */
+  void ReleaseNextHop (uint32_t id);
+
+  /**
+   * \param id next hop identifier
+   * \return the gateway of the next hop
+   */
+  Ipv4Address GetGateway (uint32_t id) const
+  {
+    return m_nextHops[id].gateway;
+  }
+
+  /**
+   * \param id next hop identifier
+   * \return the interface of the next hop
+   */
+  uint32_t GetInterface (uint32_t id) const
+  {
+    return m_nextHops[id].interface;
+  }
+
+  /**
+   * \param id next hop identifier
+   * \return true if both the gateway and the interface of the next hop are up
+   */
+  bool IsUsable (uint32_t id) const
+  {
+    return m_nextHops[id].gatewayUp && m_nextHops[id].interfaceUp;
+  }
+
+  /**
+   * \brief Change the state of every next hop through a gateway.
+   * \param gateway gateway address
+   * \param up new state
+   * \return true if a next hop changed state
+   */
+  bool SetGatewayState (Ipv4Address gateway, bool up);
+
+  /**
+   * \brief Change the state of every next hop through an interface.
+   * \param interface interface index
+   * \param up new state
+   * \return true if a next hop changed state
+   */
+  bool SetInterfaceState (uint32_t interface, bool up);
+
+  /**
+   * \brief Get a reference to the group of a list of next hops, creating it
+   * if needed.
+   * \param members next hops and metrics, in selection order
+   * \return the group identifier
+   */
+  uint32_t AddGroup (const std::vector<Member> &members);
+
+  /**
+   * \brief Drop a reference to a group.
+   * \param id group identifier
+   */
+  void ReleaseGroup (uint32_t id);
+
+  /**
+   * \brief Loop-free alternate condition (\RFC{5286}) for hop count metrics.
+   *
+   * A neighbor N is loop-free for a destination d if D(N,d) < D(N,S) + D(S,d).
+   * With hop counts, D(N,S) is 1 and the metric of the route through N is
+   * D(N,d) + 1, so the route is loop-free if its metric is at most the
+   * metric of the failed best route plus one.
+   *
+   * \param metric metric of the alternate route
+   * \param failed lowest metric of the failed routes, 0xffffffff if none failed
+   * \return true if the alternate cannot loop back through this node
+   */
+  static bool IsLoopFree (uint32_t metric, uint32_t failed)
+  {
+    return failed == 0xffffffff || metric <= failed + 1;
+  }
+
+  /**
+   * \brief Pick the next hop of a flow among the active next hops of a group.
+   *
+   * The member index lets the caller keep per-prefix data (the route of each
+   * member) in the order of the members, and reach it without a search.
+   *
+   * \param id group identifier
+   * \param flowHash hash of the flow
+   * \return the index of the member selected in the member list of the
+   * group, or NONE if no next hop of the group is usable
+   */
+  uint32_t Select (uint32_t id, uint32_t flowHash) const
+  {
+    const std::vector<uint32_t> &active = m_groups[id].active;
+    if (active.empty ())
+      {
+        return NONE;
+      }
+    return active[active.size () == 1 ? 0 : flowHash % active.size ()];
+  }
+
+  /**
+   * \param id group identifier
+   * \return the indices of the active members of the group, in member
+   * order, empty if no next hop of the group is usable
+   */
+  const std::vector<uint32_t>& GetActive (uint32_t id) const
+  {
+    return m_groups[id].active;
+  }
+
+  /**
+   * \brief Drop every next hop and group.
+   */
+  void Clear (void);
+
+  /**
+   * \return the number of next hops
+   */
+  uint32_t GetNNextHops (void) const;
+
+  /**
+   * \return the number of groups
+   */
+  uint32_t GetNGroups (void) const;
+
+private:
+  /// A next hop
+  struct NextHop
+  {
+    Ipv4Address gateway; //!< gateway address
+    uint32_t interface; //!< interface index
+    bool gatewayUp; //!< the gateway is reachable
+    bool interfaceUp; //!< the interface is up
+    uint32_t refs; //!< number of references, 0 if free
+    std::vector<uint32_t> groups; //!< groups using the next hop
+  };
+
+  /// A next-hop group
+  struct Group
+  {
+    std::vector<Member> members; //!< next hops and metrics, in selection order
+    std::vector<uint32_t> active; //!< indices of the usable members with the lowest metric, if loop-free
+    uint32_t refs; //!< number of references, 0 if free
+  };
+
+  /// Key of a next hop: gateway and interface
+  typedef std::pair<uint32_t, uint32_t> NextHopKey;
+
+  /**
+   * \brief Recompute the active next hops of a group.
+   * \param id group identifier
+   */
+  void UpdateGroup (uint32_t id);
+
+  /**
+   * \brief Recompute the groups using a next hop after it changed state.
+   * \param id next hop identifier
+   */
+  void UpdateNextHop (uint32_t id);
+
+  std::vector<NextHop> m_nextHops; //!< next hops, by identifier
+  std::vector<uint32_t> m_freeNextHops; //!< released next hop identifiers
+  std::map<NextHopKey, uint32_t> m_nextHopIds; //!< next hops by (gateway, interface)
+  std::map<uint32_t, std::vector<uint32_t> > m_interfaceNextHops; //!< next hops by interface, in no order
+  std::vector<Group> m_groups; //!< groups, by identifier
+  std::vector<uint32_t> m_freeGroups; //!< released group identifiers
+  std::map<std::vector<Member>, uint32_t> m_groupIds; //!< groups by member list
+};
+
+}
+#endif /* PIO_NEXT_HOP_H */
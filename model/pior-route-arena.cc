@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+* Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2 as
+* published by the Free Software Foundation;
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+*/
+
+#include "pior-route-arena.h"
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+PIORouteArena::PIORouteArena () : m_freeLists (ClassOf (MAX_BLOCK) + 1, 0),
+                                  m_cursor (0),
+                                  m_left (0),
+                                  m_inUse (0)
+{
+  /*cstrctr*/
+}
+
+PIORouteArena::~PIORouteArena ()
+{
+  for (std::vector<char*>::iterator it = m_slabs.begin (); it != m_slabs.end (); it++)
+    {
+      ::operator delete (*it);
+    }
+}
+
+void*
+PIORouteArena::Allocate (std::size_t size)
+{
+  if (size > MAX_BLOCK)
+    {
+      m_inUse += size;
+      return ::operator new (size);
+    }
+
+  std::size_t sizeClass = ClassOf (size);
+  m_inUse += sizeClass * GRANULE;
+
+  FreeBlock *block = m_freeLists[sizeClass];
+  if (block != 0)
+    {
+      m_freeLists[sizeClass] = block->next;
+      return block;
+    }
+
+  std::size_t blockSize = sizeClass * GRANULE;
+  if (m_left < blockSize)
+    {
+      // the tail of the current slab is dropped, it is smaller than a block
+      m_cursor = static_cast<char*> (::operator new (SLAB_SIZE));
+      m_left = SLAB_SIZE;
+      m_slabs.push_back (m_cursor);
+    }
+  void *fresh = m_cursor;
+  m_cursor += blockSize;
+  m_left -= blockSize;
+  return fresh;
+}
+
+void
+PIORouteArena::Deallocate (void *block, std::size_t size)
+{
+  if (block == 0)
+    {
+      return;
+    }
+
+  if (size > MAX_BLOCK)
+    {
+      m_inUse -= size;
+      ::operator delete (block);
+      return;
+    }
+
+  std::size_t sizeClass = ClassOf (size);
+  NS_ASSERT (m_inUse >= sizeClass * GRANULE);
+  m_inUse -= sizeClass * GRANULE;
+
+  FreeBlock *freed = static_cast<FreeBlock*> (block);
+  freed->next = m_freeLists[sizeClass];
+  m_freeLists[sizeClass] = freed;
+}
+
+uint64_t
+PIORouteArena::GetMemoryUsage (void) const
+{
+  return uint64_t (m_slabs.size ()) * SLAB_SIZE;
+}
+
+uint64_t
+PIORouteArena::GetBytesInUse (void) const
+{
+  return m_inUse;
+}
+
+}
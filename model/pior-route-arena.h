@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_ROUTE_ARENA_H
+#define PIO_ROUTE_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief Slab allocator for the per-route objects of a routing protocol.
+ *
+ * Small blocks are carved out of large slabs and recycled through one free
+ * list per size class, so the objects drawn from the arena cost no heap call
+ * and no allocator header once the slabs are warm, and the records of a
+ * table stay close together. Blocks larger than MAX_BLOCK are passed to the
+ * global allocator.
+ *
+ * The routing protocol draws from it the route entries, the nodes of the
+ * routing table and of its indexes, and the route trie nodes with their
+ * route lists. The next-hop table, whose next hops and groups are shared by
+ * many routes, and the Ipv4Route built for a route on first use come from
+ * the global heap.
+ *
+ * The slabs are released when the arena is destroyed; every object
+ * allocated from it must be gone by then.
+ */
+class PIORouteArena
+{
+public:
+  PIORouteArena ();
+  ~PIORouteArena ();
+
+  /**
+   * \param size block size, in bytes
+   * \return a block aligned for any type up to 8 bytes of alignment
+   */
+  void* Allocate (std::size_t size);
+
+  /**
+   * \param block block returned by Allocate
+   * \param size size given to Allocate
+   */
+  void Deallocate (void *block, std::size_t size);
+
+  /**
+   * \return the memory reserved by the slabs, in bytes
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+  /**
+   * \return the memory handed out in blocks and not yet released, in bytes
+   */
+  uint64_t GetBytesInUse (void) const;
+
+private:
+  PIORouteArena (const PIORouteArena &);
+  PIORouteArena& operator= (const PIORouteArena &);
+
+  static const std::size_t GRANULE = 8; //!< size class granularity and block alignment
+  static const std::size_t MAX_BLOCK = 256; //!< largest block served from the slabs
+  static const std::size_t SLAB_SIZE = 64 * 1024; //!< slab size
+
+  /// Free block, linked in the free list of its size class
+  struct FreeBlock
+  {
+    FreeBlock *next; //!< next free block of the same size class
+  };
+
+  /**
+   * \param size block size
+   * \return the size class of the block, a block can always hold a FreeBlock
+   */
+  static std::size_t ClassOf (std::size_t size)
+  {
+    return size == 0 ? 1 : (size + GRANULE - 1) / GRANULE;
+  }
+
+  std::vector<FreeBlock*> m_freeLists; //!< free blocks, by size class
+  std::vector<char*> m_slabs; //!< slabs reserved so far
+  char *m_cursor; //!< first unused byte of the current slab
+  std::size_t m_left; //!< unused bytes in the current slab
+  uint64_t m_inUse; //!< bytes handed out
+};
+
+/**
+ * \ingroup PIO
+ * \brief Standard allocator drawing from a PIORouteArena, used by the
+ * node-based containers of the routing table.
+ */
+template <typename T>
+class PIOArenaAllocator
+{
+public:
+  typedef T value_type; //!< allocated type
+  typedef T* pointer; //!< pointer type
+  typedef const T* const_pointer; //!< constant pointer type
+  typedef T& reference; //!< reference type
+  typedef const T& const_reference; //!< constant reference type
+  typedef std::size_t size_type; //!< size type
+  typedef std::ptrdiff_t difference_type; //!< difference type
+
+  /// Allocator of another type sharing the same arena
+  template <typename U>
+  struct rebind
+  {
+    typedef PIOArenaAllocator<U> other; //!< rebound allocator
+  };
+
+  /**
+   * \param arena the arena to allocate from
+   */
+  explicit PIOArenaAllocator (PIORouteArena *arena) : m_arena (arena)
+  {
+  }
+
+  /**
+   * \param other allocator of another type
+   */
+  template <typename U>
+  PIOArenaAllocator (const PIOArenaAllocator<U> &other) : m_arena (other.GetArena ())
+  {
+  }
+
+  pointer allocate (size_type n, const void * = 0)
+  {
+    return static_cast<pointer> (m_arena->Allocate (n * sizeof (T)));
+  }
+  void deallocate (pointer p, size_type n)
+  {
+    m_arena->Deallocate (p, n * sizeof (T));
+  }
+  void construct (pointer p, const T &value)
+  {
+    new (static_cast<void*> (p)) T (value);
+  }
+  void destroy (pointer p)
+  {
+    p->~T ();
+  }
+  pointer address (reference x) const
+  {
+    return &x;
+  }
+  const_pointer address (const_reference x) const
+  {
+    return &x;
+  }
+  size_type max_size (void) const
+  {
+    return size_type (-1) / sizeof (T);
+  }
+
+  /**
+   * \return the arena the allocator draws from
+   */
+  PIORouteArena* GetArena (void) const
+  {
+    return m_arena;
+  }
+
+private:
+  PIORouteArena *m_arena; //!< the arena
+};
+
+template <typename T, typename U>
+bool operator== (const PIOArenaAllocator<T> &a, const PIOArenaAllocator<U> &b)
+{
+  return a.GetArena () == b.GetArena ();
+}
+
+template <typename T, typename U>
+bool operator!= (const PIOArenaAllocator<T> &a, const PIOArenaAllocator<U> &b)
+{
+  return a.GetArena () != b.GetArena ();
+}
+
+}
+
+#endif /* PIO_ROUTE_ARENA_H */
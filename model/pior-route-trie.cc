@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+* Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2 as
+* published by the Free Software Foundation;
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+*/
+
+#include <algorithm>
+
+#include "pior-route-trie.h"
+#include "pior.h"
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+const uint32_t PIORouteTrie::NONE;
+
+PIORouteTrie::PIORouteTrie (PIORouteArena *arena) : m_arena (arena),
+                                                    m_root (0),
+                                                    m_nPrefixes (0),
+                                                    m_nNodes (0)
+{
+  /*cstrctr*/
+}
+
+PIORouteTrie::~PIORouteTrie ()
+{
+  Clear ();
+}
+
+PIORouteTrie::Node*
+PIORouteTrie::NewNode (uint32_t prefix, uint8_t length, Node *parent)
+{
+  Node *node = new (m_arena->Allocate (sizeof (Node))) Node (m_arena);
+  node->prefix = prefix & MaskOf (length);
+  node->length = length;
+  node->parent = parent;
+  node->child[0] = 0;
+  node->child[1] = 0;
+  node->group = NONE;
+  m_nNodes++;
+  return node;
+}
+
+void
+PIORouteTrie::DeleteNode (Node *node)
+{
+  NS_ASSERT (m_nNodes > 0);
+  m_nNodes--;
+  node->~Node ();
+  m_arena->Deallocate (node, sizeof (Node));
+}
+
+void
+PIORouteTrie::DeleteNodes (Node *node)
+{
+  if (node != 0)
+    {
+      DeleteNodes (node->child[0]);
+      DeleteNodes (node->child[1]);
+      DeleteNode (node);
+    }
+}
+
+void
+PIORouteTrie::Clear (void)
+{
+  DeleteNodes (m_root);
+  m_root = 0;
+  m_nPrefixes = 0;
+}
+
+void
+PIORouteTrie::Insert (PIORoutingEntry *route)
+{
+  Node *node = GetNode (route->GetDestNetwork ().Get (), route->GetDestNetworkMask ().GetPrefixLength ());
+  if (node->routes.empty ())
+    {
+      m_nPrefixes++;
+    }
+  node->routes.push_front (route);
+}
+
+PIORouteTrie::Node*
+PIORouteTrie::GetNode (uint32_t prefix, uint8_t length)
+{
+  prefix &= MaskOf (length);
+
+  Node *parent = 0;
+  Node **link = &m_root;
+
+  while (*link != 0)
+    {
+      Node *node = *link;
+
+      // length of the prefix shared by the node and the new prefix
+      uint8_t common = 0;
+      uint32_t diff = node->prefix ^ prefix;
+      while (common < 32 && !(diff & (0x80000000 >> common)))
+        {
+          common++;
+        }
+      common = std::min (common, std::min (node->length, length));
+
+      if (common < node->length)
+        {
+          // The new prefix diverges from the node (or covers it): the node is
+          // moved one level down, under either the new prefix or a branch node.
+          Node *added = NewNode (prefix, length, parent);
+          *link = added;
+          if (common == length)
+            {
+              added->child[BitAt (node->prefix, length)] = node;
+              node->parent = added;
+            }
+          else
+            {
+              Node *branch = NewNode (prefix, common, parent);
+              *link = branch;
+              branch->child[BitAt (node->prefix, common)] = node;
+              branch->child[BitAt (prefix, common)] = added;
+              node->parent = branch;
+              added->parent = branch;
+            }
+          return added;
+        }
+
+      if (node->length == length)
+        {
+          return node;
+        }
+
+      parent = node;
+      link = &node->child[BitAt (prefix, node->length)];
+    }
+
+  *link = NewNode (prefix, length, parent);
+  return *link;
+}
+
+uint32_t
+PIORouteTrie::GetPath (uint32_t key, const Node *path[33]) const
+{
+  uint32_t depth = 0;
+
+  const Node *node = m_root;
+  while (node != 0)
+    {
+      if ((key ^ node->prefix) & MaskOf (node->length))
+        {
+          break;
+        }
+      path[depth++] = node;
+      if (node->length == 32)
+        {
+          break;
+        }
+      node = node->child[BitAt (key, node->length)];
+    }
+  return depth;
+}
+
+PIORouteTrie::Node*
+PIORouteTrie::FindNode (uint32_t prefix, uint8_t length) const
+{
+  prefix &= MaskOf (length);
+
+  Node *node = m_root;
+  while (node != 0 && node->length <= length)
+    {
+      if ((prefix ^ node->prefix) & MaskOf (node->length))
+        {
+          return 0;
+        }
+      if (node->length == length)
+        {
+          return node;
+        }
+      node = node->child[BitAt (prefix, node->length)];
+    }
+  return 0;
+}
+
+bool
+PIORouteTrie::Remove (PIORoutingEntry *route)
+{
+  uint8_t length = route->GetDestNetworkMask ().GetPrefixLength ();
+  Node *node = FindNode (route->GetDestNetwork ().Get (), length);
+
+  if (node == 0)
+    {
+      return false;
+    }
+
+  for (RouteList::iterator it = node->routes.begin (); it != node->routes.end (); it++)
+    {
+      if (*it == route)
+        {
+          node->routes.erase (it);
+          if (node->routes.empty ())
+            {
+              m_nPrefixes--;
+              Prune (node);
+            }
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+PIORouteTrie::Prune (Node *node)
+{
+  while (node != 0 && node->routes.empty () && node->group == NONE)
+    {
+      if (node->child[0] != 0 && node->child[1] != 0)
+        {
+          // still needed to branch
+          return;
+        }
+
+      Node *parent = node->parent;
+      Node *child = node->child[0] != 0 ? node->child[0] : node->child[1];
+      Node **link = (parent == 0) ? &m_root : &parent->child[BitAt (node->prefix, parent->length)];
+
+      *link = child;
+      if (child != 0)
+        {
+          child->parent = parent;
+        }
+      DeleteNode (node);
+
+      node = parent;
+    }
+}
+
+const PIORouteTrie::RouteList*
+PIORouteTrie::Find (Ipv4Address network, Ipv4Mask mask) const
+{
+  Node *node = FindNode (network.Get (), mask.GetPrefixLength ());
+
+  if (node == 0 || node->routes.empty ())
+    {
+      return 0;
+    }
+  return &node->routes;
+}
+
+uint32_t
+PIORouteTrie::SetGroup (Ipv4Address network, uint8_t length, uint32_t group,
+                        const std::vector<PIORoutingEntry*> &paths)
+{
+  Node *node;
+  if (group == NONE)
+    {
+      node = FindNode (network.Get (), length);
+      if (node == 0)
+        {
+          return NONE;
+        }
+    }
+  else
+    {
+      node = GetNode (network.Get (), length);
+    }
+
+  uint32_t previous = node->group;
+  node->group = group;
+  node->paths.assign (paths.begin (), paths.end ());
+  if (group == NONE && node->routes.empty ())
+    {
+      Prune (node);
+    }
+  return previous;
+}
+
+uint32_t
+PIORouteTrie::GetGroup (Ipv4Address network, uint8_t length) const
+{
+  Node *node = FindNode (network.Get (), length);
+  return node == 0 ? NONE : node->group;
+}
+
+const PIORouteTrie::PathList*
+PIORouteTrie::GetPaths (Ipv4Address network, uint8_t length) const
+{
+  Node *node = FindNode (network.Get (), length);
+  return (node == 0 || node->group == NONE) ? 0 : &node->paths;
+}
+
+uint32_t
+PIORouteTrie::GetNPrefixes (void) const
+{
+  return m_nPrefixes;
+}
+
+uint32_t
+PIORouteTrie::GetNNodes (void) const
+{
+  return m_nNodes;
+}
+
+}
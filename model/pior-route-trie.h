@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_ROUTE_TRIE_H
+#define PIO_ROUTE_TRIE_H
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/ipv4-address.h"
+
+#include "pior-route-arena.h"
+
+namespace ns3 {
+
+class PIORoutingEntry;
+
+/**
+ * \ingroup PIO
+ * \brief Path-compressed binary trie (Patricia trie) indexing the PIO routes
+ * by (network, mask).
+ *
+ * Each trie node represents one prefix and keeps every route record installed
+ * for that prefix, most recently added first: the candidate routes of the
+ * RIB. It also keeps the FIB entry of the prefix, i.e., the next-hop group
+ * selected among the candidates by the routing protocol, with the route of
+ * each member of the group so that a FIB lookup ends on the route record
+ * without going through the candidates again. Nodes that only exist to
+ * branch carry neither routes nor group. The trie does not own the route
+ * records nor the groups; the routing protocol inserts and removes them
+ * together with its routing table.
+ *
+ * A lookup walks at most one node per prefix bit, so its cost is bounded by
+ * the address length and does not depend on the number of routes.
+ *
+ * The nodes and their route and member lists are allocated from the route
+ * arena of the routing protocol, which must outlive the trie.
+ */
+class PIORouteTrie
+{
+public:
+  static const uint32_t NONE = 0xffffffff; //!< no group
+
+  /// Routes of a prefix, most recently added first
+  typedef std::list<PIORoutingEntry*, PIOArenaAllocator<PIORoutingEntry*> > RouteList;
+
+  /// Routes of the members of the group of a prefix, in member order
+  typedef std::vector<PIORoutingEntry*, PIOArenaAllocator<PIORoutingEntry*> > PathList;
+
+  /**
+   * \param arena the arena the nodes are allocated from
+   */
+  explicit PIORouteTrie (PIORouteArena *arena);
+  ~PIORouteTrie ();
+
+  /**
+   * \brief Index a route under its (network, mask) prefix.
+   * \param route the route record
+   */
+  void Insert (PIORoutingEntry *route);
+
+  /**
+   * \brief Remove a route from the index.
+   * \param route the route record
+   * \return true if the route was found
+   */
+  bool Remove (PIORoutingEntry *route);
+
+  /**
+   * \brief Remove every route and release the trie nodes.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Longest-prefix-match lookup.
+   *
+   * The prefixes covering the address are visited from the longest to the
+   * shortest one, and the first prefix holding a route accepted by the filter
+   * is returned. Choosing among the routes of that prefix is left to the
+   * caller, so that a prefix can be reached through several next hops.
+   *
+   * \param address destination address
+   * \param filter functor called as filter (const PIORoutingEntry *) returning
+   * true if the route can be used
+   * \return the routes of the matching prefix (most recent first), or 0 if none
+   */
+  template <typename Filter>
+  const RouteList* Lookup (Ipv4Address address, Filter filter) const;
+
+  /**
+   * \brief Exact-match lookup.
+   * \param network network address
+   * \param mask network mask
+   * \return the routes installed for that prefix, or 0 if there are none
+   */
+  const RouteList* Find (Ipv4Address network, Ipv4Mask mask) const;
+
+  /**
+   * \brief Set the FIB entry of a prefix.
+   *
+   * A prefix without routes may keep its group until it is unset, so that
+   * the group can be released after the last route is removed.
+   *
+   * \param network network address
+   * \param length prefix length
+   * \param group the next-hop group selected for the prefix, or NONE to unset it
+   * \param paths the route of each member of the group, in member order
+   * (empty when unsetting)
+   * \return the previous group of the prefix, or NONE
+   */
+  uint32_t SetGroup (Ipv4Address network, uint8_t length, uint32_t group,
+                     const std::vector<PIORoutingEntry*> &paths = std::vector<PIORoutingEntry*> ());
+
+  /**
+   * \param network network address
+   * \param length prefix length
+   * \return the group of the prefix, or NONE
+   */
+  uint32_t GetGroup (Ipv4Address network, uint8_t length) const;
+
+  /**
+   * \param network network address
+   * \param length prefix length
+   * \return the routes of the members of the group of the prefix, or 0 if
+   * the prefix has no group. The list stays at the same address until the
+   * group of the prefix is unset.
+   */
+  const PathList* GetPaths (Ipv4Address network, uint8_t length) const;
+
+  /**
+   * \brief Longest-prefix-match lookup in the FIB.
+   *
+   * The groups of the prefixes covering the address are tried from the
+   * longest to the shortest prefix, until the selector picks a member.
+   *
+   * \param address destination address
+   * \param select functor called as select (group) returning the index of a
+   * member, or NONE if no next hop of the group can be used
+   * \return the route of the selected member, or 0
+   */
+  template <typename Select>
+  PIORoutingEntry* LookupGroup (Ipv4Address address, Select select) const;
+
+  /**
+   * \return the number of prefixes holding at least one route
+   */
+  uint32_t GetNPrefixes (void) const;
+
+  /**
+   * \return the number of trie nodes, including the nodes that only branch
+   */
+  uint32_t GetNNodes (void) const;
+
+private:
+  PIORouteTrie (const PIORouteTrie &);
+  PIORouteTrie &operator = (const PIORouteTrie &);
+
+  /// A trie node, i.e., a prefix
+  struct Node
+  {
+    /**
+     * \param arena the arena the route and member lists are allocated from
+     */
+    explicit Node (PIORouteArena *arena) : routes (PIOArenaAllocator<PIORoutingEntry*> (arena)),
+                                           paths (PIOArenaAllocator<PIORoutingEntry*> (arena))
+    {
+    }
+
+    uint32_t prefix; //!< prefix bits (host bits are zero)
+    uint8_t length; //!< prefix length
+    Node *parent; //!< parent node
+    Node *child[2]; //!< children, indexed by the bit following the prefix
+    RouteList routes; //!< routes for this prefix
+    uint32_t group; //!< next-hop group selected for this prefix, or NONE
+    PathList paths; //!< routes of the members of the group, in member order
+  };
+
+  /**
+   * \brief Allocate a node.
+   * \param prefix prefix bits
+   * \param length prefix length
+   * \param parent parent node
+   * \return the new node
+   */
+  Node* NewNode (uint32_t prefix, uint8_t length, Node *parent);
+
+  /**
+   * \brief Free a node.
+   * \param node the node
+   */
+  void DeleteNode (Node *node);
+
+  /**
+   * \brief Delete a sub-trie.
+   * \param node root of the sub-trie
+   */
+  void DeleteNodes (Node *node);
+
+  /**
+   * \brief Find the node of the given prefix.
+   * \param prefix prefix bits
+   * \param length prefix length
+   * \return the node or 0
+   */
+  Node* FindNode (uint32_t prefix, uint8_t length) const;
+
+  /**
+   * \brief Find the node of the given prefix, creating it if needed.
+   * \param prefix prefix bits
+   * \param length prefix length
+   * \return the node
+   */
+  Node* GetNode (uint32_t prefix, uint8_t length);
+
+  /**
+   * \brief Collect the nodes of the prefixes covering an address.
+   * \param key the address
+   * \param path filled with the nodes, from the shortest to the longest prefix
+   * \return the number of nodes
+   */
+  uint32_t GetPath (uint32_t key, const Node *path[33]) const;
+
+  /**
+   * \brief Remove a node without routes nor group if it is not needed to
+   * branch anymore.
+   * \param node the node
+   */
+  void Prune (Node *node);
+
+  /**
+   * \param length prefix length
+   * \return the network mask of the given length
+   */
+  static uint32_t MaskOf (uint8_t length)
+  {
+    return length == 0 ? 0 : (0xffffffff << (32 - length));
+  }
+
+  /**
+   * \param bits the address
+   * \param position bit position, 0 being the most significant bit
+   * \return the bit value
+   */
+  static uint32_t BitAt (uint32_t bits, uint8_t position)
+  {
+    return (bits >> (31 - position)) & 1;
+  }
+
+  PIORouteArena *m_arena; //!< arena the nodes are allocated from
+  Node *m_root; //!< root of the trie
+  uint32_t m_nPrefixes; //!< number of prefixes holding routes
+  uint32_t m_nNodes; //!< number of trie nodes
+};
+
+template <typename Filter>
+const PIORouteTrie::RouteList*
+PIORouteTrie::Lookup (Ipv4Address address, Filter filter) const
+{
+  const Node *path[33];
+  uint32_t depth = GetPath (address.Get (), path);
+
+  while (depth > 0)
+    {
+      const RouteList &routes = path[--depth]->routes;
+      for (RouteList::const_iterator it = routes.begin (); it != routes.end (); it++)
+        {
+          if (filter (*it))
+            {
+              return &routes;
+            }
+        }
+    }
+  return 0;
+}
+
+template <typename Select>
+PIORoutingEntry*
+PIORouteTrie::LookupGroup (Ipv4Address address, Select select) const
+{
+  const Node *path[33];
+  uint32_t depth = GetPath (address.Get (), path);
+
+  while (depth > 0)
+    {
+      const Node *node = path[--depth];
+      if (node->group != NONE)
+        {
+          uint32_t member = select (node->group);
+          if (member != NONE)
+            {
+              return node->paths[member];
+            }
+        }
+    }
+  return 0;
+}
+
+}
+#endif /* PIO_ROUTE_TRIE_H */
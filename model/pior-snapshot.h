@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_SNAPSHOT_H
+#define PIO_SNAPSHOT_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief Header of a routing table snapshot file.
+ *
+ * A snapshot file is this header followed by nRecords PIOSnapshotRecord,
+ * grouped by node. Fields are stored in host byte order; a file written on
+ * a host of the other byte order is rejected by the magic number.
+ */
+struct PIOSnapshotHeader
+{
+  static const uint32_t MAGIC = 0x50494f53; //!< "PIOS"
+  static const uint32_t VERSION = 1; //!< current format version
+
+  uint32_t magic; //!< MAGIC
+  uint32_t version; //!< format version
+  uint32_t recordSize; //!< sizeof (PIOSnapshotRecord)
+  uint32_t reserved; //!< zero
+  uint64_t nRecords; //!< number of records following the header
+};
+
+/**
+ * \ingroup PIO
+ * \brief One route of a routing table snapshot, 24 bytes.
+ */
+struct PIOSnapshotRecord
+{
+  static const uint16_t PERMANENT = 0x0001; //!< the route does not expire
+
+  uint32_t node; //!< id of the node owning the route
+  uint32_t network; //!< network address
+  uint32_t mask; //!< network mask
+  uint32_t gateway; //!< next hop, 0.0.0.0 for a directly connected network
+  uint16_t interface; //!< interface index
+  uint16_t flags; //!< PERMANENT
+  uint16_t metric; //!< the cumulative hop count to the destination network
+  uint16_t sequenceNo; //!< sequence number of the route
+};
+
+}
+#endif /* PIO_SNAPSHOT_H */
@@ -0,0 +1,388 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIO_TIMER_WHEEL_H
+#define PIO_TIMER_WHEEL_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup PIO
+ * \brief Hierarchical timer wheel.
+ *
+ * Time is counted in ticks. The wheel has LEVELS levels of SLOTS slots; a
+ * slot of level L spans SLOTS^L ticks. A timer is placed in the lowest level
+ * whose current span contains its expiry tick, and moves down one level or
+ * more when the wheel reaches the start of its slot (cascade). Timers too
+ * far in the future wait in an overflow list until the top level wraps.
+ *
+ * The wheel does not schedule anything by itself: the owner asks for the
+ * next tick that needs work (GetNextTick), advances the wheel to the current
+ * tick (Advance) and then pops the expired timers (PopDue) one by one.
+ * Expiry ticks are placed relative to the last tick the wheel was advanced
+ * to, so an owner whose clock moved on must advance the wheel before
+ * scheduling; timers expiring meanwhile become due (HasDue).
+ * Timers still due can be cancelled while the owner processes the others.
+ *
+ * Timers are identified by an index in an internal pool; scheduling,
+ * cancelling and expiring a timer take constant time.
+ *
+ * \tparam T payload carried by the timers
+ */
+template <typename T>
+class PIOTimerWheel
+{
+public:
+  static const uint32_t NONE = 0xffffffff; //!< identifier of no timer
+  static const uint64_t NEVER = ~uint64_t (0); //!< tick returned when no timer is pending
+
+  PIOTimerWheel () : m_now (0),
+                     m_nTimers (0),
+                     m_free (NONE)
+  {
+    Clear ();
+  }
+
+  /**
+   * \brief Arm a timer.
+   * \param expiry expiry tick, moved to the next tick if already reached
+   * \param payload value returned by PopDue when the timer expires
+   * \return the timer identifier
+   */
+  uint32_t Schedule (uint64_t expiry, const T &payload)
+  {
+    uint32_t id;
+    if (m_free == NONE)
+      {
+        id = m_nodes.size ();
+        m_nodes.push_back (Node ());
+      }
+    else
+      {
+        id = m_free;
+        m_free = m_nodes[id].next;
+      }
+    Node &node = m_nodes[id];
+    node.payload = payload;
+    node.expiry = expiry > m_now ? expiry : m_now + 1;
+    m_nTimers++;
+    Place (id);
+    return id;
+  }
+
+  /**
+   * \brief Disarm a pending or due timer.
+   * \param id timer identifier
+   */
+  void Cancel (uint32_t id)
+  {
+    NS_ASSERT (id < m_nodes.size () && m_nodes[id].list != NONE);
+    Unlink (id);
+    Release (id);
+  }
+
+  /**
+   * \param id timer identifier
+   * \return the expiry tick of the timer
+   */
+  uint64_t GetExpiry (uint32_t id) const
+  {
+    return m_nodes[id].expiry;
+  }
+
+  /**
+   * \brief Move the wheel forward, making due every timer expiring at or
+   * before the given tick.
+   * \param now current tick
+   */
+  void Advance (uint64_t now)
+  {
+    while (m_now < now)
+      {
+        uint64_t next = GetNextTick ();
+        if (next > now)
+          {
+            m_now = now;
+            return;
+          }
+        m_now = next;
+
+        if ((m_now & (TopSpan () - 1)) == 0)
+          {
+            Cascade (OVERFLOW_LIST);
+          }
+        for (int level = LEVELS - 1; level > 0; level--)
+          {
+            if ((m_now & ((uint64_t (1) << (level * SLOT_BITS)) - 1)) == 0)
+              {
+                Cascade (level * SLOTS + SlotOf (m_now, level));
+              }
+          }
+        Cascade (SlotOf (m_now, 0));
+      }
+  }
+
+  /**
+   * \brief Take one expired timer.
+   * \param payload set to the payload of the timer
+   * \return false if no timer is due
+   */
+  bool PopDue (T &payload)
+  {
+    uint32_t id = m_heads[DUE_LIST];
+    if (id == NONE)
+      {
+        return false;
+      }
+    payload = m_nodes[id].payload;
+    Unlink (id);
+    Release (id);
+    return true;
+  }
+
+  /**
+   * \return the next tick at which a timer expires or has to be cascaded,
+   * or NEVER if the wheel is empty
+   */
+  uint64_t GetNextTick (void) const
+  {
+    uint64_t next = NEVER;
+    for (int level = 0; level < LEVELS; level++)
+      {
+        uint32_t shift = level * SLOT_BITS;
+        uint32_t current = SlotOf (m_now, level);
+        uint64_t later = m_occupied[level] & ~((uint64_t (2) << current) - 1);
+        if (later != 0)
+          {
+            uint64_t base = (m_now >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+            uint64_t tick = base | (uint64_t (LowestBit (later)) << shift);
+            next = tick < next ? tick : next;
+          }
+      }
+    if (m_heads[OVERFLOW_LIST] != NONE)
+      {
+        uint64_t tick = ((m_now / TopSpan ()) + 1) * TopSpan ();
+        next = tick < next ? tick : next;
+      }
+    return next;
+  }
+
+  /**
+   * \return true if expired timers wait to be popped
+   */
+  bool HasDue (void) const
+  {
+    return m_heads[DUE_LIST] != NONE;
+  }
+
+  /**
+   * \return the last tick the wheel was advanced to
+   */
+  uint64_t GetNow (void) const
+  {
+    return m_now;
+  }
+
+  /**
+   * \return the number of pending and due timers
+   */
+  uint32_t GetNTimers (void) const
+  {
+    return m_nTimers;
+  }
+
+  /**
+   * \brief Disarm every timer and release the pool.
+   */
+  void Clear (void)
+  {
+    std::vector<Node> ().swap (m_nodes);
+    m_heads.assign (LISTS, NONE);
+    for (int level = 0; level < LEVELS; level++)
+      {
+        m_occupied[level] = 0;
+      }
+    m_free = NONE;
+    m_nTimers = 0;
+  }
+
+private:
+  static const int SLOT_BITS = 6; //!< log2 of the number of slots per level
+  static const int SLOTS = 1 << SLOT_BITS; //!< slots per level
+  static const int LEVELS = 4; //!< number of levels
+  static const uint32_t OVERFLOW_LIST = LEVELS * SLOTS; //!< list of the timers beyond the top level
+  static const uint32_t DUE_LIST = OVERFLOW_LIST + 1; //!< list of the expired timers
+  static const uint32_t LISTS = DUE_LIST + 1; //!< number of lists
+
+  /// Timer, linked in one list at a time
+  struct Node
+  {
+    T payload; //!< payload of the timer
+    uint64_t expiry; //!< expiry tick
+    uint32_t prev; //!< previous timer of the list
+    uint32_t next; //!< next timer of the list, or next free node
+    uint32_t list; //!< list holding the timer, NONE if free
+  };
+
+  /**
+   * \return the number of ticks covered by the whole wheel
+   */
+  static uint64_t TopSpan (void)
+  {
+    return uint64_t (1) << (LEVELS * SLOT_BITS);
+  }
+
+  /**
+   * \param tick a tick
+   * \param level a level
+   * \return the slot of the tick in the level
+   */
+  static uint32_t SlotOf (uint64_t tick, int level)
+  {
+    return (tick >> (level * SLOT_BITS)) & (SLOTS - 1);
+  }
+
+  /**
+   * \param bits a non-zero bitmap
+   * \return the index of its lowest set bit
+   */
+  static uint32_t LowestBit (uint64_t bits)
+  {
+    return __builtin_ctzll (bits);
+  }
+
+  /**
+   * \brief Link a timer in the list matching its expiry.
+   * \param id timer identifier
+   */
+  void Place (uint32_t id)
+  {
+    uint64_t expiry = m_nodes[id].expiry;
+    if (expiry <= m_now)
+      {
+        Link (id, DUE_LIST);
+        return;
+      }
+    for (int level = 0; level < LEVELS; level++)
+      {
+        uint32_t shift = (level + 1) * SLOT_BITS;
+        if ((expiry >> shift) == (m_now >> shift))
+          {
+            Link (id, level * SLOTS + SlotOf (expiry, level));
+            return;
+          }
+      }
+    Link (id, OVERFLOW_LIST);
+  }
+
+  /**
+   * \brief Re-place every timer of a list, the wheel having moved.
+   * \param list the list
+   */
+  void Cascade (uint32_t list)
+  {
+    uint32_t id = m_heads[list];
+    while (id != NONE)
+      {
+        uint32_t next = m_nodes[id].next;
+        Unlink (id);
+        Place (id);
+        id = next;
+      }
+  }
+
+  /**
+   * \param id timer identifier
+   * \param list list to link the timer in
+   */
+  void Link (uint32_t id, uint32_t list)
+  {
+    Node &node = m_nodes[id];
+    node.list = list;
+    node.prev = NONE;
+    node.next = m_heads[list];
+    if (node.next != NONE)
+      {
+        m_nodes[node.next].prev = id;
+      }
+    m_heads[list] = id;
+    if (list < OVERFLOW_LIST)
+      {
+        m_occupied[list / SLOTS] |= uint64_t (1) << (list % SLOTS);
+      }
+  }
+
+  /**
+   * \param id timer identifier, removed from its list
+   */
+  void Unlink (uint32_t id)
+  {
+    Node &node = m_nodes[id];
+    if (node.prev != NONE)
+      {
+        m_nodes[node.prev].next = node.next;
+      }
+    else
+      {
+        m_heads[node.list] = node.next;
+      }
+    if (node.next != NONE)
+      {
+        m_nodes[node.next].prev = node.prev;
+      }
+    if (node.list < OVERFLOW_LIST && m_heads[node.list] == NONE)
+      {
+        m_occupied[node.list / SLOTS] &= ~(uint64_t (1) << (node.list % SLOTS));
+      }
+    node.list = NONE;
+  }
+
+  /**
+   * \param id unlinked timer identifier, returned to the pool
+   */
+  void Release (uint32_t id)
+  {
+    m_nodes[id].payload = T ();
+    m_nodes[id].next = m_free;
+    m_free = id;
+    m_nTimers--;
+  }
+
+  uint64_t m_now; //!< last tick the wheel was advanced to
+  uint32_t m_nTimers; //!< number of pending and due timers
+  std::vector<Node> m_nodes; //!< timer pool
+  uint32_t m_free; //!< first free node of the pool
+  std::vector<uint32_t> m_heads; //!< first timer of each slot, of the overflow and of the due list
+  uint64_t m_occupied[LEVELS]; //!< non-empty slots of each level
+};
+
+template <typename T> const uint32_t PIOTimerWheel<T>::NONE;
+template <typename T> const uint64_t PIOTimerWheel<T>::NEVER;
+template <typename T> const uint32_t PIOTimerWheel<T>::OVERFLOW_LIST;
+template <typename T> const uint32_t PIOTimerWheel<T>::DUE_LIST;
+template <typename T> const uint32_t PIOTimerWheel<T>::LISTS;
+
+}
+#endif /* PIO_TIMER_WHEEL_H */
@@ -27,6 +27,7 @@ LOG_LEVEL_LOGIC	LOG_LOGIC and above.
 LOG_LEVEL_ALL	All severity classes.
 LOG_ALL	Synonym for LOG_LEVEL_ALL
 */
+#include <algorithm>
 #include <iomanip>
 
 #include "pior.h"
@@ -39,24 +40,264 @@ LOG_ALL	Synonym for LOG_LEVEL_ALL
 #include "ns3/node.h"
 #include "ns3/udp-header.h"
 #include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
 #include "ns3/udp-socket-factory.h"
 #include "ns3/timer.h"
 #include "ns3/ipv4-packet-info-tag.h"
+#include "ns3/inet-socket-address.h"
 
 NS_LOG_COMPONENT_DEFINE ("PIORoutingProtocol");
 
 namespace ns3 {
+
+/**
+ * \brief Route filter used by the forwarding lookup.
+ *
+ * A route can be used if it is VALID, if its next hop is usable and, when
+ * an output interface is given, if it goes out through that interface.
+ */
+struct ForwardingFilter
+{
+  ForwardingFilter (int32_t interface, const PIONextHopTable *nextHops) : m_interface (interface),
+                                                                          m_nextHops (nextHops)
+  {
+  }
+
+  bool operator () (const PIORoutingEntry *route) const
+  {
+    if (route->GetValidity () != VALID || !m_nextHops->IsUsable (route->GetNextHop ()))
+      {
+        return false;
+      }
+    return (m_interface < 0) || (route->GetInterface () == uint32_t (m_interface));
+  }
+
+  /**
+   * \param route a route
+   * \return true if the route is VALID but its next hop is not usable
+   */
+  bool IsFailed (const PIORoutingEntry *route) const
+  {
+    return route->GetValidity () == VALID && !m_nextHops->IsUsable (route->GetNextHop ());
+  }
+
+  int32_t m_interface; //!< requested output interface, -1 if any
+  const PIONextHopTable *m_nextHops; //!< next hops of the routes
+};
+
+/**
+ * \param sequenceNo a sequence number
+ * \param other another sequence number
+ * \return true if the first sequence number is more recent, modulo 2^16
+ */
+static bool
+IsNewerSequence (uint16_t sequenceNo, uint16_t other)
+{
+  return int16_t (sequenceNo - other) > 0;
+}
+
+/**
+ * \brief Best-path order of the routes of a prefix: the lowest metric first,
+ * then the most recent sequence number.
+ * \param route a route
+ * \param other another route of the same prefix
+ * \return true if the route is a better path than the other one
+ */
+static bool
+IsBetterPath (const PIORoutingEntry *route, const PIORoutingEntry *other)
+{
+  return route->GetMetric () < other->GetMetric ()
+    || (route->GetMetric () == other->GetMetric () && IsNewerSequence (route->GetSequenceNo (), other->GetSequenceNo ()));
+}
+
+/**
+ * \param routes the routes of a prefix
+ * \return the best VALID route of the prefix, see IsBetterPath, or 0
+ */
+static const PIORoutingEntry*
+GetBestPath (const PIORouteTrie::RouteList &routes)
+{
+  const PIORoutingEntry *best = 0;
+  for (PIORouteTrie::RouteList::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      if ((*it)->GetValidity () == VALID && (best == 0 || IsBetterPath (*it, best)))
+        {
+          best = *it;
+        }
+    }
+  return best;
+}
+
+/**
+ * \brief The VALID routes of a prefix are its candidate paths: the routes of
+ * the best metric sharing the sequence number of the best path are its
+ * equal-cost paths, the routes of higher metric are backups, but a route of
+ * the best metric advertised with an older sequence number is stale.
+ * \param route a VALID route
+ * \param best the best path of its prefix, see GetBestPath
+ * \return true if the route is a candidate path
+ */
+static bool
+IsCandidatePath (const PIORoutingEntry *route, const PIORoutingEntry *best)
+{
+  return route->GetMetric () != best->GetMetric () || route->GetSequenceNo () == best->GetSequenceNo ();
+}
+
+/**
+ * \brief Pick the route of a flow among the routes of a prefix.
+ *
+ * The selection follows the FIB groups: among the candidate paths of the
+ * prefix (see IsCandidatePath), the routes accepted by the filter having the
+ * lowest metric are equal-cost next hops; the flow hash selects one of them.
+ * When better candidates have failed, the selected routes must be loop-free
+ * alternates of them (see PIONextHopTable::IsLoopFree). Two passes over the
+ * routes avoid building the set.
+ *
+ * \param routes the routes of the prefix
+ * \param filter route filter, see PIORouteTrie::Lookup
+ * \param flowHash hash of the flow
+ * \return the selected route, or 0 if the filter accepts none
+ */
+template <typename Filter>
+static PIORoutingEntry*
+SelectRoute (const PIORouteTrie::RouteList &routes, Filter filter, uint32_t flowHash)
+{
+  const PIORoutingEntry *best = GetBestPath (routes);
+  if (best == 0)
+    {
+      return 0;
+    }
+
+  uint16_t metric = 0;
+  uint32_t nRoutes = 0;
+  uint32_t failed = 0xffffffff;
+  for (PIORouteTrie::RouteList::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      if ((*it)->GetValidity () != VALID || !IsCandidatePath (*it, best))
+        {
+          continue;
+        }
+      if (filter.IsFailed (*it))
+        {
+          failed = std::min<uint32_t> (failed, (*it)->GetMetric ());
+        }
+      else if (filter (*it))
+        {
+          if (nRoutes == 0 || (*it)->GetMetric () < metric)
+            {
+              metric = (*it)->GetMetric ();
+              nRoutes = 1;
+            }
+          else if ((*it)->GetMetric () == metric)
+            {
+              nRoutes++;
+            }
+        }
+    }
+
+  if (nRoutes == 0 || !PIONextHopTable::IsLoopFree (metric, failed))
+    {
+      return 0;
+    }
+
+  uint32_t selected = (nRoutes > 1) ? flowHash % nRoutes : 0;
+  for (PIORouteTrie::RouteList::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      if ((*it)->GetMetric () == metric && filter (*it) && IsCandidatePath (*it, best) && selected-- == 0)
+        {
+          return *it;
+        }
+    }
+  return 0;
+}
+
+/**
+ * \brief Selector of the member of a flow in the FIB groups, see
+ * PIORouteTrie::LookupGroup.
+ */
+struct GroupSelector
+{
+  GroupSelector (const PIONextHopTable *nextHops, uint32_t flowHash) : m_nextHops (nextHops),
+                                                                       m_flowHash (flowHash)
+  {
+  }
+
+  uint32_t operator () (uint32_t group) const
+  {
+    return m_nextHops->Select (group, m_flowHash);
+  }
+
+  const PIONextHopTable *m_nextHops; //!< next-hop groups
+  uint32_t m_flowHash; //!< hash of the flow
+};
+
+/**
+ * \brief Mix a 32-bit word into a hash (MurmurHash3 round).
+ * \param hash the hash so far
+ * \param word the word
+ * \return the new hash
+ */
+static uint32_t
+MixHash (uint32_t hash, uint32_t word)
+{
+  word *= 0xcc9e2d51;
+  word = (word << 15) | (word >> 17);
+  word *= 0x1b873593;
+  hash ^= word;
+  hash = (hash << 13) | (hash >> 19);
+  return hash * 5 + 0xe6546b64;
+}
+
+/**
+ * \brief Finalize a hash (MurmurHash3 avalanche).
+ * \param hash the hash
+ * \return the final hash
+ */
+static uint32_t
+FinalizeHash (uint32_t hash)
+{
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (PIORoutingProtocol);
 /* 
 * my Routing Protocol
 */
-PIORoutingProtocol::PIORoutingProtocol() :  m_ipv4 (0),
-                                              m_initialized (false)
+PIORoutingProtocol::PIORoutingProtocol() :  m_routing (RouteAllocator (&m_routeArena)),
+                                              m_routesByGateway (std::less<Ipv4Address> (), GatewayIndex::allocator_type (&m_routeArena)),
+                                              m_routesByInterface (std::less<uint32_t> (), InterfaceIndex::allocator_type (&m_routeArena)),
+                                              m_routesByPrefix (std::less<uint64_t> (), PrefixIndex::allocator_type (&m_routeArena)),
+                                              m_routeTrie (&m_routeArena),
+                                              m_routeTimerEventTick (0),
+                                              m_compiledFibEnabled (false),
+                                              m_compiledFibBuilt (false),
+                                              m_routeCacheSize (0),
+                                              m_routeGeneration (1),
+                                              m_flowHashSeed (0),
+                                              m_loadBalancing (FLOW_HASH),
+                                              m_flowletTableSize (0),
+                                              m_flowletsStarted (0),
+                                              m_routeCacheHits (0),
+                                              m_routeCacheMisses (0),
+                                              m_ipv4 (0),
+                                              m_initialized (false),
+                                              m_fastDetection (false),
+                                              m_detectMultiplier (3)
 {
   m_rng = CreateObject<UniformRandomVariable> ();
 }
 
-PIORoutingProtocol::~PIORoutingProtocol () {/*destructor*/}
+PIORoutingProtocol::~PIORoutingProtocol ()
+{
+  DeleteTables ();
+}
 
 TypeId PIORoutingProtocol::GetTypeId (void)
 {
@@ -67,6 +308,10 @@ TypeId PIORoutingProtocol::GetTypeId (void)
 			              TimeValue (Seconds(30)), /*This has to be adjust according to the user's requirment*/
 			              MakeTimeAccessor (&PIORoutingProtocol::m_kamTimer),
 			              MakeTimeChecker ())
+    .AddAttribute ( "MinKeepAliveInterval","The time between two Keep Alive Messages after a neighbor appeared or was lost; it doubles up to KeepAliveInterval while the neighbors are stable.",
+			              TimeValue (Seconds(5)),
+			              MakeTimeAccessor (&PIORoutingProtocol::m_minKamTimer),
+			              MakeTimeChecker ())
     .AddAttribute ( "NeighborTimeoutDelay","The delay to mark a neighbor as unresponsive.",
 			              TimeValue (Seconds(60)), /*This has to be adjust according to the user's requirment*/
 			              MakeTimeAccessor (&PIORoutingProtocol::m_neighborTimeoutDelay),
@@ -75,6 +320,10 @@ TypeId PIORoutingProtocol::GetTypeId (void)
 			              TimeValue (Seconds(10)), /*This has to be adjust according to the user's requirment*/
 			              MakeTimeAccessor (&PIORoutingProtocol::m_garbageCollectionDelay),
 			              MakeTimeChecker ())
+    .AddAttribute ( "RouteTimerResolution","Tick of the timer wheel driving route timeout and garbage collection; timers expire at most one tick late.",
+			              TimeValue (MilliSeconds (10)),
+			              MakeTimeAccessor (&PIORoutingProtocol::m_routeTimerResolution),
+			              MakeTimeChecker ())
     .AddAttribute ( "StartupDelay", "Maximum random delay for protocol startup.",
                     TimeValue (Seconds(1)),
                     MakeTimeAccessor (&PIORoutingProtocol::m_startupDelay),
@@ -106,6 +355,51 @@ TypeId PIORoutingProtocol::GetTypeId (void)
                     MakeEnumAccessor (&PIORoutingProtocol::m_print),
                     MakeEnumChecker ( MAIN_R_TABLE, "MainRoutingTable",
                                       N_TABLE, "NeighborTable"))
+    .AddAttribute ( "CompiledFib", "Forward using a DIR-24-8 compiled forwarding table (64 MiB per node) instead of the route trie.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&PIORoutingProtocol::m_compiledFibEnabled),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "RouteCacheSize", "Number of entries of the destination to route cache (0 disables the cache).",
+                    UintegerValue (1024),
+                    MakeUintegerAccessor (&PIORoutingProtocol::m_routeCacheSize),
+                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ( "LoadBalancing", "Load balancing over equal-cost next hops of forwarded packets.",
+                    EnumValue (FLOW_HASH),
+                    MakeEnumAccessor (&PIORoutingProtocol::m_loadBalancing),
+                    MakeEnumChecker (FLOW_HASH, "FlowHash",
+                                     FLOWLET, "Flowlet"))
+    .AddAttribute ( "FlowletTimeout", "Idle gap after which a flow may move to another equal-cost next hop (Flowlet load balancing).",
+                    TimeValue (MilliSeconds (1)),
+                    MakeTimeAccessor (&PIORoutingProtocol::m_flowletTimeout),
+                    MakeTimeChecker ())
+    .AddAttribute ( "FlowletTableSize", "Number of entries of the flowlet table (Flowlet load balancing).",
+                    UintegerValue (4096),
+                    MakeUintegerAccessor (&PIORoutingProtocol::m_flowletTableSize),
+                    MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ( "FastFailureDetection", "Detect the loss of a neighbor with BFD-style probes instead of the neighbor timeout only.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&PIORoutingProtocol::m_fastDetection),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "ProbeInterval", "The time between two fast failure detection probes.",
+                    TimeValue (MilliSeconds (10)),
+                    MakeTimeAccessor (&PIORoutingProtocol::m_probeInterval),
+                    MakeTimeChecker ())
+    .AddAttribute ( "DetectMultiplier", "Number of probe intervals without a probe from a neighbor before it is lost.",
+                    UintegerValue (3),
+                    MakeUintegerAccessor (&PIORoutingProtocol::m_detectMultiplier),
+                    MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("FlowletsStarted",
+                     "Number of flowlets started by forwarded packets (Flowlet load balancing)",
+                     MakeTraceSourceAccessor (&PIORoutingProtocol::m_flowletsStarted),
+                     "ns3::TracedValue::Uint32Callback")
+    .AddTraceSource ("RouteCacheHits",
+                     "Number of route lookups served by the route cache",
+                     MakeTraceSourceAccessor (&PIORoutingProtocol::m_routeCacheHits),
+                     "ns3::TracedValue::Uint32Callback")
+    .AddTraceSource ("RouteCacheMisses",
+                     "Number of route lookups that missed the route cache",
+                     MakeTraceSourceAccessor (&PIORoutingProtocol::m_routeCacheMisses),
+                     "ns3::TracedValue::Uint32Callback")
   ;
   return tid;
 }
@@ -129,30 +423,215 @@ PIORoutingProtocol::DoInitialize ()
 
   int n = m_ipv4->GetObject<Node>()->GetId();
   NS_LOG_LOGIC ("DoInitialize: node=" << n);
+
+  m_flowHashSeed = FinalizeHash (n + 1);
+
+  for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+  {
+    if (m_ipv4->IsUp (i))
+    {
+      OpenInterfaceSocket (i);
+    }
+  }
+
+  if (!m_recvSocket)
+  {
+    NS_LOG_LOGIC ("PIO: adding receiving socket");
+    TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+    m_recvSocket = Socket::CreateSocket (GetObject<Node> (), tid);
+    m_recvSocket->Bind (InetSocketAddress (Ipv4Address (PIO_ALL_NODE), PIO_PORT));
+    m_recvSocket->SetRecvCallback (MakeCallback (&PIORoutingProtocol::Receive, this));
+    m_recvSocket->SetIpRecvTtl (true);
+    m_recvSocket->SetRecvPktInfo (true);
+  }
+
+  // the neighbors learn our routes with the first periodic update
+  Time delay = Seconds (m_rng->GetValue (0.01, m_startupDelay.GetSeconds ()));
+  m_nextRouteRequest = Simulator::Schedule (delay, &PIORoutingProtocol::SendRouteRequest, this);
+  if (m_fastDetection)
+  {
+    m_probeEvent = Simulator::Schedule (delay, &PIORoutingProtocol::ProbeTick, this);
+  }
+  m_nextPeriodicUpdate = Simulator::Schedule (delay, &PIORoutingProtocol::SendPeriodicUpdate, this);
 }
 
 void 
 PIORoutingProtocol::NotifyInterfaceUp (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
+
+  FlushRouteCache ();
+  bool changed = m_nextHops.SetInterfaceState (interface, true);
+  AddLocalAddresses (interface);
+  for (uint32_t i = 0; i < m_ipv4->GetNAddresses (interface); i++)
+  {
+    AddConnectedRoute (interface, m_ipv4->GetAddress (interface, i));
+  }
+  if (changed)
+  {
+    RecordInterfaceChange (interface);
+  }
+
+  if (m_initialized)
+  {
+    OpenInterfaceSocket (interface);
+  }
 }
 
 void 
 PIORoutingProtocol::NotifyInterfaceDown (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
+
+  FlushRouteCache ();
+
+  // The prefixes using the interface move to their other next hops at once,
+  // when those are loop-free alternates; the other prefixes lose their routes
+  bool changed = m_nextHops.SetInterfaceState (interface, false);
+  InvalidateRoutesWithoutAlternate (interface);
+  RemoveConnectedRoutes (interface);
+  if (changed)
+  {
+    RecordInterfaceChange (interface);
+  }
+
+  // The addresses of a down interface are still local addresses of the node
+  // (weak host model), as the packets addressed to them are delivered locally.
+  AddLocalAddresses (interface);
+
+  CloseInterfaceSocket (interface);
 }
 
 void 
 PIORoutingProtocol::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << " interface " << interface << " address " << address);
+
+  FlushRouteCache ();
+  ResetIpv4Routes (interface);
+  m_localAddresses.insert (std::make_pair (address.GetLocal ().Get (), interface));
+
+  if (m_ipv4->IsUp (interface))
+  {
+    AddConnectedRoute (interface, address);
+    if (m_initialized)
+    {
+      OpenInterfaceSocket (interface);
+    }
+  }
 }
 
 void
 PIORoutingProtocol::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << " interface " << interface << " address " << address);
+
+  FlushRouteCache ();
+  ResetIpv4Routes (interface);
+  RemoveConnectedRoute (interface, address);
+
+  LocalAddressMap::iterator it = m_localAddresses.find (address.GetLocal ().Get ());
+  if (it != m_localAddresses.end () && it->second == interface)
+  {
+    // the same address may still be configured on another interface
+    RebuildLocalAddresses ();
+  }
+}
+
+void
+PIORoutingProtocol::AddLocalAddresses (uint32_t interface)
+{
+  for (uint32_t i = 0; i < m_ipv4->GetNAddresses (interface); i++)
+  {
+    m_localAddresses.insert (std::make_pair (m_ipv4->GetAddress (interface, i).GetLocal ().Get (), interface));
+  }
+}
+
+void
+PIORoutingProtocol::AddConnectedRoute (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  if (address.GetScope () != Ipv4InterfaceAddress::GLOBAL)
+  {
+    return;
+  }
+  Ipv4Mask mask = address.GetMask ();
+  Ipv4Address network = address.GetLocal ().CombineMask (mask);
+
+  RoutesI it;
+  if (FindRoute (network, mask, Ipv4Address::GetZero (), interface, it))
+  {
+    PIORoutingEntry *route = it->first;
+    if (route->GetValidity () != VALID)
+    {
+      // the withdrawal was advertised with the odd sequence number
+      CancelRouteTimer (it);
+      route->SetConnected (true);
+      route->SetValidity (VALID);
+      route->SetMetric (0);
+      route->SetSequenceNo ((route->GetSequenceNo () + 2) & ~1);
+      route->SetRouteChanged (true);
+      UpdateForwarding (network, mask);
+      RecordChange (network, mask);
+    }
+    return;
+  }
+
+  NS_LOG_LOGIC ("PIO: adding the connected route to " << network << mask << " on interface " << interface);
+  AddNetworkRouteTo (network, mask, interface, 0, 0, Seconds (0), Seconds (0));
+  // the route just added is the first one of the table
+  m_routing.begin ()->first->SetConnected (true);
+}
+
+void
+PIORoutingProtocol::RemoveConnectedRoute (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  if (address.GetScope () != Ipv4InterfaceAddress::GLOBAL)
+  {
+    return;
+  }
+  Ipv4Mask mask = address.GetMask ();
+  Ipv4Address network = address.GetLocal ().CombineMask (mask);
+
+  for (uint32_t i = 0; i < m_ipv4->GetNAddresses (interface); i++)
+  {
+    Ipv4InterfaceAddress other = m_ipv4->GetAddress (interface, i);
+    if (other.GetScope () == Ipv4InterfaceAddress::GLOBAL && other.GetMask () == mask && other.GetLocal ().CombineMask (mask) == network)
+    {
+      return;
+    }
+  }
+
+  RoutesI it;
+  if (FindRoute (network, mask, Ipv4Address::GetZero (), interface, it) && it->first->GetValidity () == VALID
+      && it->first->GetConnected ())
+  {
+    NS_LOG_LOGIC ("PIO: withdrawing the connected route to " << network << mask << " on interface " << interface);
+    InvalidateRecord (it);
+  }
+}
+
+void
+PIORoutingProtocol::RemoveConnectedRoutes (uint32_t interface)
+{
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> range = m_routesByInterface.equal_range (interface);
+  for (InterfaceIndex::iterator i = range.first; i != range.second; i++)
+  {
+    PIORoutingEntry *route = i->second->first;
+    if (route->GetValidity () == VALID && route->GetConnected ())
+    {
+      InvalidateRecord (i->second);
+    }
+  }
+}
+
+void
+PIORoutingProtocol::RebuildLocalAddresses (void)
+{
+  m_localAddresses.clear ();
+  for (uint32_t j = 0; j < m_ipv4->GetNInterfaces (); j++)
+  {
+    AddLocalAddresses (j);
+  }
 }
 
 void 
@@ -192,7 +671,7 @@ PIORoutingProtocol::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
   	*os << "Node: " << GetObject<Node> ()->GetId ()
     	  << " Time: " << Simulator::Now ().GetSeconds () << "s "
      		<< "PIO Neighbor Table" << '\n';
-        //PrintNeighborTable (stream);
+    PrintNeighborTable (stream);
 	}
 	else if (m_print == MAIN_R_TABLE)
 	{
@@ -244,7 +723,7 @@ PIORoutingProtocol::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
         *os << std::setiosflags (std::ios::left) << std::setw (7) << route->GetRouteChanged ();
         
         // printing how many seconds left for next event trigger
-        *os << std::setiosflags (std::ios::left) << std::setw (8) << Simulator::GetDelayLeft (it->second).GetSeconds ();
+        *os << std::setiosflags (std::ios::left) << std::setw (8) << GetRouteTimerLeft (it).GetSeconds ();
        
         *os << '\n';
       }        
@@ -257,14 +736,17 @@ PIORoutingProtocol::AddNetworkRouteTo (Ipv4Address network, Ipv4Mask networkMask
 {
   NS_LOG_FUNCTION (this << network << networkMask << nextHop << interface);
 
-  PIORoutingEntry* route = new PIORoutingEntry (network, networkMask, nextHop, interface);
+  PIORoutingEntry* route = new (AllocateRoute ()) PIORoutingEntry (network, networkMask, nextHop, interface);
   route->SetSequenceNo (sequenceNo);
   route->SetMetric (metric);
   route->SetValidity (VALID);
   route->SetRouteChanged (true); 
 
-  EventId invalidateEvent;
-  
+  NS_LOG_LOGIC ("PIO: adding the nextHop route " << *route << " to the routing table");
+  m_routing.push_front (std::make_pair (route, RouteTimerWheel::NONE));
+  RoutesI it = m_routing.begin ();
+  IndexRoute (it);
+
   if (network == "0.0.0.0" && networkMask == Ipv4Mask::GetZero ())
   {
     // Add the default Route. As the default route is added manual by either
@@ -273,17 +755,15 @@ PIORoutingProtocol::AddNetworkRouteTo (Ipv4Address network, Ipv4Mask networkMask
     // However, as this route is not setting to expire, we do not set the invalidate event.
     // Further, as the route is set as valid, the route will be advertise in periodic update.
     // Thus, as the route is not going to change, the route is not included in to the triggered update.
-    
-    invalidateEvent = EventId ();
   }
   else
   {
     Time delay = timeoutTime + Seconds (m_rng->GetValue (0, 5));
-    invalidateEvent = Simulator::Schedule (delay, &PIORoutingProtocol::InvalidateRoute, this, route);
+    ScheduleRouteTimer (it, delay);
   }
 
-  NS_LOG_LOGIC ("PIO: adding the nextHop route " << *route << " to the routing table");
-  m_routing.push_front (std::make_pair (route, invalidateEvent));
+  UpdateForwarding (network, networkMask);
+  RecordChange (network, networkMask);
 }
 
 void 
@@ -291,24 +771,25 @@ PIORoutingProtocol::AddNetworkRouteTo (Ipv4Address network, Ipv4Mask networkMask
 {
   NS_LOG_FUNCTION (this << network << networkMask << interface);
 
-  PIORoutingEntry* route = new PIORoutingEntry (network, networkMask, interface);
+  PIORoutingEntry* route = new (AllocateRoute ()) PIORoutingEntry (network, networkMask, interface);
   route->SetSequenceNo (sequenceNo);
   route->SetMetric (metric);
   route->SetValidity (VALID);
   route->SetRouteChanged (true); 
 
-  EventId invalidateEvent;
+  NS_LOG_LOGIC ("PIO: adding the interface route " << *route << " to the routing table");
+  m_routing.push_front (std::make_pair (route, RouteTimerWheel::NONE));
+  RoutesI it = m_routing.begin ();
+  IndexRoute (it);
 
-  if ((timeoutTime.GetSeconds () == 0) && (garbageCollectionTime.GetSeconds () == 0))
-    invalidateEvent = EventId ();
-  else
+  if ((timeoutTime.GetSeconds () != 0) || (garbageCollectionTime.GetSeconds () != 0))
   {
     Time delay = timeoutTime + Seconds (m_rng->GetValue (0, 5));
-    EventId invalidateEvent = Simulator::Schedule (delay, &PIORoutingProtocol::InvalidateRoute, this, route);
+    ScheduleRouteTimer (it, delay);
   }
 
-  NS_LOG_LOGIC ("PIO: adding the interface route " << *route << " to the routing table");
-  m_routing.push_front (std::make_pair (route, invalidateEvent));
+  UpdateForwarding (network, networkMask);
+  RecordChange (network, networkMask);
 }
 
 void 
@@ -316,7 +797,7 @@ PIORoutingProtocol::AddHostRouteTo (Ipv4Address host, uint32_t interface, uint16
 {
   NS_LOG_FUNCTION ("AddHostRouteTo: " << this << host << interface);
 
-  PIORoutingEntry* route = new PIORoutingEntry (host, interface);
+  PIORoutingEntry* route = new (AllocateRoute ()) PIORoutingEntry (host, interface);
 
   if (host == "127.0.0.1")
   {
@@ -324,7 +805,8 @@ PIORoutingProtocol::AddHostRouteTo (Ipv4Address host, uint32_t interface, uint16
     route->SetSequenceNo (0);
     route->SetMetric (0);
     route->SetRouteChanged (false); 
-    m_routing.push_front (std::make_pair (route, EventId ()));
+    m_routing.push_front (std::make_pair (route, RouteTimerWheel::NONE));
+    IndexRoute (m_routing.begin ());
   }
   else
   {
@@ -333,11 +815,15 @@ PIORoutingProtocol::AddHostRouteTo (Ipv4Address host, uint32_t interface, uint16
     route->SetMetric (metric);
     route->SetRouteChanged (true); 
 
-    Time delay = timeoutTime + Seconds (m_rng->GetValue (0, 5));
-    EventId invalidateEvent = Simulator::Schedule (delay, &PIORoutingProtocol::InvalidateRoute, this, route);
-
     NS_LOG_LOGIC ("PIO: adding the host route " << *route << " to the routing table");
-    m_routing.push_front (std::make_pair (route, invalidateEvent));
+    m_routing.push_front (std::make_pair (route, RouteTimerWheel::NONE));
+    RoutesI it = m_routing.begin ();
+    IndexRoute (it);
+
+    Time delay = timeoutTime + Seconds (m_rng->GetValue (0, 5));
+    ScheduleRouteTimer (it, delay);
+    UpdateForwarding (host, Ipv4Mask::GetOnes ());
+    RecordChange (host, Ipv4Mask::GetOnes ());
   }
 }
 
@@ -350,332 +836,1847 @@ PIORoutingProtocol::AddDefaultRouteTo (Ipv4Address nextHop, uint32_t interface)
   NS_LOG_LOGIC ("PIO: adding the default route to the routing table of " << this->GetTypeId ());
 }
 
-void 
-PIORoutingProtocol::InvalidateRoute (PIORoutingEntry *route)
+uint32_t
+PIORoutingProtocol::AddRoutes (const std::vector<PIORouteSpec> &routes)
 {
-  NS_LOG_FUNCTION (this << *route);
-
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
-    {
-      if (it->first == route)
-        {
-          it->first->SetValidity (INVALID);
-          it->first->SetRouteChanged (true);
-          it->second.Cancel ();
-          it->second = Simulator::Schedule (m_garbageCollectionDelay, &PIORoutingProtocol::DeleteRoute, this, it->first);
-          return;
-        }
-    }
-  NS_LOG_INFO ("PIO: Cannot find a route to invalidate.");
+  return AddRoutes (0, routes);
 }
 
-void 
-PIORoutingProtocol::DeleteRoute (PIORoutingEntry *route)
+uint32_t
+PIORoutingProtocol::LoadRoutes (const PIOSnapshotRecord *records, uint32_t nRecords)
 {
-  NS_LOG_FUNCTION (this << *route);
+  NS_LOG_FUNCTION (this << nRecords);
 
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+  uint32_t added = 0;
+  for (const PIOSnapshotRecord *record = records; record != records + nRecords; record++)
+  {
+    PIORouteSpec spec (Ipv4Address (record->network), Ipv4Mask (record->mask), Ipv4Address (record->gateway),
+                       record->interface, record->metric, record->sequenceNo, Seconds (0), Seconds (0));
+    if (!(record->flags & PIOSnapshotRecord::PERMANENT))
     {
-      if (it->first == route)
-        {
-          delete route;
-          m_routing.erase (it);
-          return;
-        }
+      spec.timeoutTime = m_routeTimeoutDelay;
+      spec.garbageCollectionTime = m_garbageCollectionDelay;
     }
-  NS_LOG_INFO ("PIO: Cannot find a route to delete.");
+    if (InstallRoute (0, spec))
+      added++;
+  }
+  EndInstallRoutes (0, added);
+
+  NS_LOG_LOGIC ("PIO: loaded " << added << " of " << nRecords << " routes");
+  return added;
 }
 
-bool 
-PIORoutingProtocol::InvalidateRoutesForInterface (uint32_t interface)
+uint32_t
+PIORoutingProtocol::AddTable (void)
 {
-  NS_LOG_FUNCTION (this << interface);
+  NS_LOG_FUNCTION (this);
 
-  bool retVal = false;
+  m_vrfs.push_back (new VrfTable (&m_routeArena));
+  return m_vrfs.size ();
+}
 
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
-  {
-    if ((it->first->GetInterface () == interface) && (it->first->GetValidity () == VALID))
-    {
-      it->first->SetValidity (INVALID);
-      it->first->SetRouteChanged (true);
-      
-      it->second.Cancel ();
-      it->second = Simulator::Schedule (m_garbageCollectionDelay, &PIORoutingProtocol::DeleteRoute, this, it->first);
-      retVal = true;
-    }
-  }
-  
-  if (retVal == false)
-    NS_LOG_INFO ("PIO: no route found for the given interface.");    
-  
-  return retVal;
+uint32_t
+PIORoutingProtocol::GetNTables (void) const
+{
+  return m_vrfs.size () + 1;
 }
 
-bool 
-PIORoutingProtocol::InvalidateBrokenRoutes(Ipv4Address destination, Ipv4Mask destinationMask)
+void
+PIORoutingProtocol::SetInterfaceTable (uint32_t interface, uint32_t table)
 {
-  NS_LOG_FUNCTION (this << destination << destinationMask);
-  
-  bool retVal = false;
+  NS_LOG_FUNCTION (this << interface << table);
+  NS_ASSERT_MSG (table <= m_vrfs.size (), "PIO: unknown routing table " << table);
 
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+  if (interface >= m_interfaceTables.size ())
   {
-    if ((it->first->GetDestNetwork () == destination) && 
-				(it->first->GetDestNetworkMask () == destinationMask) && 
-				(it->first->GetValidity () == VALID))
-    {
-      it->first->SetValidity (INVALID);
-      it->first->SetRouteChanged (true);
-      
-      it->second.Cancel ();
-      it->second = Simulator::Schedule (m_garbageCollectionDelay, &PIORoutingProtocol::DeleteRoute, this, it->first);
-      retVal = true;
-    }
+    m_interfaceTables.resize (interface + 1, 0);
   }
-  
-  if (retVal == false)
-    NS_LOG_INFO ("PIO: no route found for the given destination network.");
-  
-  return retVal;
+  m_interfaceTables[interface] = table;
 }
 
-bool 
-PIORoutingProtocol::InvalidateRoutesForGateway (Ipv4Address gateway)
+uint32_t
+PIORoutingProtocol::GetInterfaceTable (uint32_t interface) const
 {
-  NS_LOG_FUNCTION (this << gateway);
-  
-  bool retVal = false;
+  return interface < m_interfaceTables.size () ? m_interfaceTables[interface] : 0;
+}
 
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+uint32_t
+PIORoutingProtocol::AddRoutes (uint32_t table, const std::vector<PIORouteSpec> &routes)
+{
+  NS_LOG_FUNCTION (this << table << routes.size ());
+  NS_ASSERT_MSG (table <= m_vrfs.size (), "PIO: unknown routing table " << table);
+
+  uint32_t added = 0;
+  for (std::vector<PIORouteSpec>::const_iterator spec = routes.begin (); spec != routes.end (); spec++)
   {
-    if ((it->first->GetGateway () == gateway) &&
-				(it->first->GetValidity () == VALID))
-    {
-      it->first->SetValidity (INVALID);
-      it->first->SetRouteChanged (true);
-      
-      it->second.Cancel ();
-      it->second = Simulator::Schedule (m_garbageCollectionDelay, &PIORoutingProtocol::DeleteRoute, this, it->first);
-      retVal = true;
-    }
+    if (InstallRoute (table, *spec))
+      added++;
   }
-  if (retVal == false)
-    NS_LOG_INFO ("PIO: no route found for the given gateway.");
-    
-  return retVal;
+  EndInstallRoutes (table, added);
+
+  NS_LOG_LOGIC ("PIO: installed " << added << " of " << routes.size () << " routes in table " << table);
+  return added;
 }
 
-bool
-PIORoutingProtocol::IsLocalRouteAvailable (Ipv4Address address, Ipv4Mask mask)
+void
+PIORoutingProtocol::SaveRoutes (uint32_t node, std::vector<PIOSnapshotRecord> &records) const
 {
-  bool retVal = false;
-
-  for (RoutesI it = m_routing.begin ();  it != m_routing.end (); it++)
+  // oldest first, so that loading the records keeps the route preference
+  for (RoutingTableInstance::const_reverse_iterator it = m_routing.rbegin (); it != m_routing.rend (); it++)
   {
-    if ((it->first->GetDestNetwork () == address) &&
-        (it->first->GetDestNetworkMask () == mask) &&
-        (it->first->GetGateway () == Ipv4Address::GetZero ()))
-    {
-      return (retVal = true);
-    }
+    PIORoutingEntry *route = it->first;
+    if (route->GetValidity () == INVALID)
+      continue;
+
+    PIOSnapshotRecord record;
+    record.node = node;
+    record.network = route->GetDestNetwork ().Get ();
+    record.mask = route->GetDestNetworkMask ().Get ();
+    record.gateway = route->GetGateway ().Get ();
+    record.interface = route->GetInterface ();
+    record.flags = (it->second == RouteTimerWheel::NONE) ? PIOSnapshotRecord::PERMANENT : 0;
+    record.metric = route->GetMetric ();
+    record.sequenceNo = route->GetSequenceNo ();
+    records.push_back (record);
   }
-  return retVal;   
 }
 
 bool
-PIORoutingProtocol::FindRouteRecord (Ipv4Address address, Ipv4Mask mask, RoutesI &foundRoute)
+PIORoutingProtocol::InstallRoute (uint32_t table, const PIORouteSpec &spec)
 {
-  bool retVal = false;
+  if (HasRoute (table, spec.network, spec.networkMask, spec.nextHop, spec.interface))
+  {
+    NS_LOG_WARN ("PIO: rejecting duplicate route to " << spec.network << spec.networkMask << " via " << spec.nextHop << " on interface " << spec.interface << " in table " << table);
+    return false;
+  }
+
+  PIORoutingEntry* route;
+  if (spec.nextHop == Ipv4Address::GetZero ())
+    route = new (AllocateRoute ()) PIORoutingEntry (spec.network, spec.networkMask, spec.interface);
+  else
+    route = new (AllocateRoute ()) PIORoutingEntry (spec.network, spec.networkMask, spec.nextHop, spec.interface);
 
-  for (RoutesI it = m_routing.begin ();  it!= m_routing.end (); it++)
+  bool localHost = table == 0 && spec.network == "127.0.0.1" && spec.networkMask == Ipv4Mask::GetOnes () && spec.nextHop == Ipv4Address::GetZero ();
+  if (localHost)
   {
-    if ((it->first->GetDestNetwork () == address) &&
-        (it->first->GetDestNetworkMask () == mask) &&
-        (it->first->GetGateway () != Ipv4Address::GetZero ()))
-    {
-      foundRoute = it;
-      retVal = true;
-      break;
-    }
+    route->SetValidity (LHOST); // Neither valid nor invalid
+    route->SetSequenceNo (0);
+    route->SetMetric (0);
+    route->SetRouteChanged (false);
+  }
+  else
+  {
+    route->SetValidity (VALID);
+    route->SetSequenceNo (spec.sequenceNo);
+    route->SetMetric (spec.metric);
+    route->SetRouteChanged (true);
   }
-  return retVal;    
-}
+
+  if (table != 0)
+  {
+    // the routes of the other tables are static and not advertised
+    VrfTable *vrf = m_vrfs[table - 1];
+    route->SetNextHop (m_nextHops.AddNextHop (route->GetGateway (), spec.interface, IsInterfaceUp (spec.interface)));
+    vrf->fib.Insert (route);
+    vrf->routes.push_back (route);
+  }
+  else
+  {
+    m_routing.push_front (std::make_pair (route, RouteTimerWheel::NONE));
+    RoutesI it = m_routing.begin ();
+    IndexRoute (it);
+
+    bool defaultRoute = spec.network == Ipv4Address::GetZero () && spec.networkMask == Ipv4Mask::GetZero ();
+    bool permanent = spec.timeoutTime.IsZero () && spec.garbageCollectionTime.IsZero ();
+    if (!localHost && !defaultRoute && !permanent)
+    {
+      // the wheel event is armed once, by EndInstallRoutes
+      Time delay = spec.timeoutTime + Seconds (m_rng->GetValue (0, 5));
+      AdvanceRouteTimers ();
+      it->second = m_routeTimers.Schedule (GetRouteTimerTick (delay), it);
+    }
+  }
+  if (!localHost)
+  {
+    // the FIB and the triggered update are updated once per prefix
+    m_installedPrefixes.push_back (PrefixKey (spec.network, spec.networkMask));
+  }
+  return true;
+}
+
+void
+PIORoutingProtocol::EndInstallRoutes (uint32_t table, uint32_t added)
+{
+  // a prefix may have been given several routes by the batch
+  std::sort (m_installedPrefixes.begin (), m_installedPrefixes.end ());
+  m_installedPrefixes.erase (std::unique (m_installedPrefixes.begin (), m_installedPrefixes.end ()), m_installedPrefixes.end ());
+  if (table == 0 && !m_installedPrefixes.empty ())
+  {
+    // the compiled forwarding table is rebuilt by the next lookup
+    m_compiledFibBuilt = false;
+  }
+  for (std::vector<uint64_t>::const_iterator it = m_installedPrefixes.begin (); it != m_installedPrefixes.end (); it++)
+  {
+    Ipv4Address network (uint32_t (*it >> 32));
+    Ipv4Mask mask (uint32_t (*it));
+    UpdateForwarding (network, mask, table);
+    if (table == 0)
+    {
+      RecordChange (network, mask);
+    }
+  }
+  m_installedPrefixes.clear ();
+
+  if (table == 0 && added > 0)
+  {
+    ArmRouteTimerEvent ();
+  }
+}
+
+bool
+PIORoutingProtocol::HasRoute (uint32_t table, Ipv4Address network, Ipv4Mask mask, Ipv4Address nextHop, uint32_t interface) const
+{
+  if (table != 0)
+  {
+    // the other tables have no prefix index, their trie is searched
+    const PIORouteTrie::RouteList* routes = m_vrfs[table - 1]->fib.Find (network, mask);
+    if (routes != 0)
+    {
+      for (PIORouteTrie::RouteList::const_iterator it = routes->begin (); it != routes->end (); it++)
+      {
+        if ((*it)->GetGateway () == nextHop && (*it)->GetInterface () == interface)
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  std::pair<PrefixIndex::const_iterator, PrefixIndex::const_iterator> range = m_routesByPrefix.equal_range (PrefixKey (network, mask));
+  for (PrefixIndex::const_iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetGateway () == nextHop && i->second->first->GetInterface () == interface)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+PIORoutingProtocol::FreeRoute (PIORoutingEntry *route)
+{
+  route->~PIORoutingEntry ();
+  m_routeArena.Deallocate (route, sizeof (PIORoutingEntry));
+}
+
+void
+PIORoutingProtocol::DeleteTables (void)
+{
+  for (std::vector<VrfTable*>::iterator vrf = m_vrfs.begin (); vrf != m_vrfs.end (); vrf++)
+  {
+    for (std::vector<PIORoutingEntry*>::iterator route = (*vrf)->routes.begin (); route != (*vrf)->routes.end (); route++)
+    {
+      FreeRoute (*route);
+    }
+    (*vrf)->fib.Clear ();
+    delete *vrf;
+  }
+  m_vrfs.clear ();
+}
+
+bool
+PIORoutingProtocol::IsInterfaceUp (uint32_t interface) const
+{
+  return m_ipv4 == 0 || interface >= m_ipv4->GetNInterfaces () || m_ipv4->IsUp (interface);
+}
+
+void
+PIORoutingProtocol::IndexRoute (RoutesI it)
+{
+  PIORoutingEntry *route = it->first;
+
+  route->SetNextHop (m_nextHops.AddNextHop (route->GetGateway (), route->GetInterface (), IsInterfaceUp (route->GetInterface ())));
+  if (!m_nextHops.IsUsable (route->GetNextHop ()) && route->GetGateway () != Ipv4Address::GetZero ())
+  {
+    // a route just learned through a gateway shows it is reachable again
+    SetGatewayState (route->GetGateway (), true);
+  }
+
+  m_routeTrie.Insert (route);
+  m_routesByGateway.insert (std::make_pair (route->GetGateway (), it));
+  m_routesByInterface.insert (std::make_pair (route->GetInterface (), it));
+  m_routesByPrefix.insert (std::make_pair (PrefixKey (route->GetDestNetwork (), route->GetDestNetworkMask ()), it));
+}
+
+void
+PIORoutingProtocol::UnindexRoute (RoutesI it)
+{
+  PIORoutingEntry *route = it->first;
+
+  m_routeTrie.Remove (route);
+  m_nextHops.ReleaseNextHop (route->GetNextHop ());
+  route->SetNextHop (PIONextHopTable::NONE);
+
+  std::pair<GatewayIndex::iterator, GatewayIndex::iterator> byGateway = m_routesByGateway.equal_range (route->GetGateway ());
+  for (GatewayIndex::iterator i = byGateway.first; i != byGateway.second; i++)
+  {
+    if (i->second == it)
+    {
+      m_routesByGateway.erase (i);
+      break;
+    }
+  }
+
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> byInterface = m_routesByInterface.equal_range (route->GetInterface ());
+  for (InterfaceIndex::iterator i = byInterface.first; i != byInterface.second; i++)
+  {
+    if (i->second == it)
+    {
+      m_routesByInterface.erase (i);
+      break;
+    }
+  }
+
+  std::pair<PrefixIndex::iterator, PrefixIndex::iterator> byPrefix = m_routesByPrefix.equal_range (PrefixKey (route->GetDestNetwork (), route->GetDestNetworkMask ()));
+  for (PrefixIndex::iterator i = byPrefix.first; i != byPrefix.second; i++)
+  {
+    if (i->second == it)
+    {
+      m_routesByPrefix.erase (i);
+      break;
+    }
+  }
+}
+
+void
+PIORoutingProtocol::InvalidateRecord (RoutesI it)
+{
+  it->first->SetValidity (INVALID);
+  it->first->SetRouteChanged (true);
+
+  ScheduleRouteTimer (it, m_garbageCollectionDelay);
+  UpdateForwarding (it->first->GetDestNetwork (), it->first->GetDestNetworkMask ());
+  RecordChange (it->first->GetDestNetwork (), it->first->GetDestNetworkMask ());
+}
+
+void
+PIORoutingProtocol::ScheduleRouteTimer (RoutesI it, Time delay)
+{
+  CancelRouteTimer (it);
+
+  AdvanceRouteTimers ();
+  it->second = m_routeTimers.Schedule (GetRouteTimerTick (delay), it);
+  ArmRouteTimerEvent ();
+}
+
+uint64_t
+PIORoutingProtocol::GetRouteTimerTick (Time delay) const
+{
+  int64_t resolution = m_routeTimerResolution.GetTimeStep ();
+  int64_t expiry = (Simulator::Now () + delay).GetTimeStep ();
+  return (expiry + resolution - 1) / resolution;
+}
+
+void
+PIORoutingProtocol::CancelRouteTimer (RoutesI it)
+{
+  if (it->second != RouteTimerWheel::NONE)
+  {
+    m_routeTimers.Cancel (it->second);
+    it->second = RouteTimerWheel::NONE;
+  }
+}
+
+Time
+PIORoutingProtocol::GetRouteTimerLeft (RoutesCI it) const
+{
+  if (it->second == RouteTimerWheel::NONE)
+  {
+    return Seconds (0);
+  }
+  Time expiry = m_routeTimerResolution * int64_t (m_routeTimers.GetExpiry (it->second));
+  return expiry > Simulator::Now () ? expiry - Simulator::Now () : Seconds (0);
+}
+
+void
+PIORoutingProtocol::AdvanceRouteTimers (void)
+{
+  m_routeTimers.Advance (Simulator::Now ().GetTimeStep () / m_routeTimerResolution.GetTimeStep ());
+}
+
+void
+PIORoutingProtocol::ArmRouteTimerEvent (void)
+{
+  // due timers are processed right away
+  uint64_t next = m_routeTimers.HasDue () ? m_routeTimers.GetNow () : m_routeTimers.GetNextTick ();
+
+  if (m_routeTimerEvent.IsRunning () && m_routeTimerEventTick <= next)
+  {
+    return;
+  }
+  m_routeTimerEvent.Cancel ();
+  if (next != RouteTimerWheel::NEVER)
+  {
+    Time delay = m_routeTimerResolution * int64_t (next) - Simulator::Now ();
+    if (delay.IsNegative ())
+    {
+      delay = Seconds (0);
+    }
+    m_routeTimerEvent = Simulator::Schedule (delay, &PIORoutingProtocol::RouteTimerTick, this);
+    m_routeTimerEventTick = next;
+  }
+}
+
+void
+PIORoutingProtocol::RouteTimerTick (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  AdvanceRouteTimers ();
+
+  RoutesI it;
+  while (m_routeTimers.PopDue (it))
+  {
+    it->second = RouteTimerWheel::NONE;
+    if (it->first->GetValidity () == VALID)
+    {
+      InvalidateRoute (it);
+    }
+    else
+    {
+      DeleteRoute (it);
+    }
+  }
+  ArmRouteTimerEvent ();
+}
+
+void
+PIORoutingProtocol::InvalidateRoute (RoutesI it)
+{
+  NS_LOG_FUNCTION (this << *it->first);
+
+  InvalidateRecord (it);
+}
+
+void
+PIORoutingProtocol::DeleteRoute (RoutesI it)
+{
+  PIORoutingEntry *route = it->first;
+
+  NS_LOG_FUNCTION (this << *route);
+
+  CancelRouteTimer (it);
+  UnindexRoute (it);
+  UpdateForwarding (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  UpdateAdvertisements (PrefixKey (route->GetDestNetwork (), route->GetDestNetworkMask ()));
+  FreeRoute (route);
+  m_routing.erase (it);
+}
+
+bool
+PIORoutingProtocol::InvalidateRoutesForInterface (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+
+  bool retVal = false;
+
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> range = m_routesByInterface.equal_range (interface);
+  for (InterfaceIndex::iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetValidity () == VALID)
+    {
+      InvalidateRecord (i->second);
+      retVal = true;
+    }
+  }
+
+  if (retVal == false)
+    NS_LOG_INFO ("PIO: no route found for the given interface.");
+
+  return retVal;
+}
+
+bool
+PIORoutingProtocol::InvalidateRoutesWithoutAlternate (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+
+  bool retVal = false;
+
+  ForwardingFilter filter (-1, &m_nextHops);
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> range = m_routesByInterface.equal_range (interface);
+  for (InterfaceIndex::iterator i = range.first; i != range.second; i++)
+  {
+    PIORoutingEntry *route = i->second->first;
+    // routes without gateway are kept, connected routes are withdrawn by
+    // RemoveConnectedRoutes
+    if (route->GetValidity () != VALID || route->GetGateway () == Ipv4Address::GetZero ())
+    {
+      continue;
+    }
+
+    const PIORouteTrie::RouteList* routes = m_routeTrie.Find (route->GetDestNetwork (), route->GetDestNetworkMask ());
+    if (routes == 0 || SelectRoute (*routes, filter, 0) == 0)
+    {
+      InvalidateRecord (i->second);
+      retVal = true;
+    }
+  }
+
+  return retVal;
+}
+
+bool
+PIORoutingProtocol::InvalidateBrokenRoutes(Ipv4Address destination, Ipv4Mask destinationMask)
+{
+  NS_LOG_FUNCTION (this << destination << destinationMask);
+
+  bool retVal = false;
+
+  std::pair<PrefixIndex::iterator, PrefixIndex::iterator> range = m_routesByPrefix.equal_range (PrefixKey (destination, destinationMask));
+  for (PrefixIndex::iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetValidity () == VALID)
+    {
+      InvalidateRecord (i->second);
+      retVal = true;
+    }
+  }
+
+  if (retVal == false)
+    NS_LOG_INFO ("PIO: no route found for the given destination network.");
+
+  return retVal;
+}
+
+bool
+PIORoutingProtocol::InvalidateRoutesForGateway (Ipv4Address gateway)
+{
+  NS_LOG_FUNCTION (this << gateway);
+
+  bool retVal = false;
+
+  // the forwarding moves away from the gateway at once, whatever the number
+  // of routes through it; the routes themselves are then invalidated
+  SetGatewayState (gateway, false);
+
+  std::pair<GatewayIndex::iterator, GatewayIndex::iterator> range = m_routesByGateway.equal_range (gateway);
+  for (GatewayIndex::iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetValidity () == VALID)
+    {
+      InvalidateRecord (i->second);
+      retVal = true;
+    }
+  }
+  if (retVal == false)
+    NS_LOG_INFO ("PIO: no route found for the given gateway.");
+
+  return retVal;
+}
+
+bool
+PIORoutingProtocol::IsLocalRouteAvailable (Ipv4Address address, Ipv4Mask mask)
+{
+  bool retVal = false;
+
+  std::pair<PrefixIndex::iterator, PrefixIndex::iterator> range = m_routesByPrefix.equal_range (PrefixKey (address, mask));
+  for (PrefixIndex::iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetGateway () == Ipv4Address::GetZero ())
+    {
+      return (retVal = true);
+    }
+  }
+  return retVal;
+}
+
+bool
+PIORoutingProtocol::FindRouteRecord (Ipv4Address address, Ipv4Mask mask, RoutesI &foundRoute)
+{
+  bool retVal = false;
+
+  // the index keeps the records of a prefix in insertion order: the most
+  // recent one, i.e., the first one in m_routing, is the last match
+  std::pair<PrefixIndex::iterator, PrefixIndex::iterator> range = m_routesByPrefix.equal_range (PrefixKey (address, mask));
+  for (PrefixIndex::iterator i = range.first; i != range.second; i++)
+  {
+    if (i->second->first->GetGateway () != Ipv4Address::GetZero ())
+    {
+      foundRoute = i->second;
+      retVal = true;
+    }
+  }
+  return retVal;
+}
+
+void
+PIORoutingProtocol::FlushRouteCache (void)
+{
+  if (++m_routeGeneration == 0)
+  {
+    // the generation wrapped around: drop the entries explicitly
+    m_routeCache.clear ();
+    m_routeGeneration = 1;
+  }
+}
+
+void
+PIORoutingProtocol::UpdateForwarding (Ipv4Address network, Ipv4Mask mask, uint32_t table)
+{
+  FlushRouteCache ();
+
+  m_groupMembers.clear ();
+  m_groupPaths.clear ();
+  const PIORouteTrie &fib = (table == 0) ? m_routeTrie : m_vrfs[table - 1]->fib;
+  const PIORouteTrie::RouteList* routes = fib.Find (network, mask);
+  if (routes != 0)
+  {
+    GetGroupMembers (*routes, m_groupMembers, m_groupPaths);
+  }
+  SetForwardingGroup (network, mask.GetPrefixLength (), m_groupMembers, m_groupPaths, table);
+}
+
+void
+PIORoutingProtocol::CompileForwarding (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_compiledFib.Clear ();
+  m_compiledFibBuilt = true;
+
+  // the groups are copied from the FIB: a prefix is compiled once, from its
+  // first record in the prefix index
+  for (PrefixIndex::const_iterator it = m_routesByPrefix.begin (); it != m_routesByPrefix.end (); it = m_routesByPrefix.upper_bound (it->first))
+  {
+    PIORoutingEntry *route = it->second->first;
+    uint8_t length = route->GetDestNetworkMask ().GetPrefixLength ();
+    uint32_t group = m_routeTrie.GetGroup (route->GetDestNetwork (), length);
+    if (group != PIORouteTrie::NONE)
+    {
+      m_compiledFib.Set (route->GetDestNetwork (), length, group, m_routeTrie.GetPaths (route->GetDestNetwork (), length));
+    }
+  }
+  NS_LOG_LOGIC ("PIO: compiled " << m_compiledFib.GetNPrefixes () << " prefixes, " << m_compiledFib.GetMemoryUsage () << " bytes");
+}
+
+void
+PIORoutingProtocol::GetGroupMembers (const PIORouteTrie::RouteList &routes, std::vector<PIONextHopTable::Member> &members,
+                                     std::vector<PIORoutingEntry*> &paths)
+{
+  // the candidate paths of the prefix, equal-cost paths and backups
+  const PIORoutingEntry *best = GetBestPath (routes);
+  members.clear ();
+  paths.clear ();
+  for (PIORouteTrie::RouteList::const_iterator it = routes.begin (); it != routes.end (); it++)
+  {
+    if ((*it)->GetValidity () == VALID && IsCandidatePath (*it, best))
+    {
+      PIONextHopTable::Member member;
+      member.nextHop = (*it)->GetNextHop ();
+      member.metric = (*it)->GetMetric ();
+      // canonical order, so that the prefixes with the same next hops share
+      // a group; the routes follow the order of the members
+      std::vector<PIONextHopTable::Member>::iterator position = std::upper_bound (members.begin (), members.end (), member);
+      paths.insert (paths.begin () + (position - members.begin ()), *it);
+      members.insert (position, member);
+    }
+  }
+}
+
+void
+PIORoutingProtocol::SetForwardingGroup (Ipv4Address network, uint8_t length, const std::vector<PIONextHopTable::Member> &members,
+                                        const std::vector<PIORoutingEntry*> &paths, uint32_t table)
+{
+  // the new group is referenced before the old one is released, so that an
+  // unchanged group is not rebuilt
+  PIORouteTrie &fib = (table == 0) ? m_routeTrie : m_vrfs[table - 1]->fib;
+  uint32_t group = members.empty () ? PIORouteTrie::NONE : m_nextHops.AddGroup (members);
+  uint32_t previous = fib.SetGroup (network, length, group, paths);
+
+  // the compiled forwarding table mirrors the FIB of the main table and
+  // holds no reference
+  if (table == 0 && m_compiledFibBuilt)
+  {
+    if (group == PIORouteTrie::NONE)
+    {
+      m_compiledFib.Unset (network, length);
+    }
+    else
+    {
+      m_compiledFib.Set (network, length, group, m_routeTrie.GetPaths (network, length));
+    }
+  }
+  if (previous != PIORouteTrie::NONE)
+  {
+    m_nextHops.ReleaseGroup (previous);
+  }
+}
+
+bool
+PIORoutingProtocol::SetGatewayState (Ipv4Address gateway, bool up)
+{
+  NS_LOG_FUNCTION (this << gateway << up);
+
+  if (m_nextHops.SetGatewayState (gateway, up))
+  {
+    FlushRouteCache ();
+    std::pair<GatewayIndex::iterator, GatewayIndex::iterator> range = m_routesByGateway.equal_range (gateway);
+    for (GatewayIndex::iterator i = range.first; i != range.second; i++)
+    {
+      RecordNextHopChange (i->second->first);
+    }
+    return true;
+  }
+  return false;
+}
+
+uint32_t
+PIORoutingProtocol::FlowHash (const Ipv4Header &header, Ptr<const Packet> p, bool transport) const
+{
+  uint32_t hash = m_flowHashSeed;
+  hash = MixHash (hash, header.GetSource ().Get ());
+  hash = MixHash (hash, header.GetDestination ().Get ());
+  hash = MixHash (hash, header.GetProtocol ());
+
+  // TCP and UDP headers both start with the source and destination ports
+  if (transport && p != 0 && (header.GetProtocol () == 6 || header.GetProtocol () == 17)
+      && header.GetFragmentOffset () == 0 && header.IsLastFragment ())
+  {
+    uint8_t ports[4];
+    if (p->CopyData (ports, 4) == 4)
+    {
+      hash = MixHash (hash, (uint32_t (ports[0]) << 24) | (uint32_t (ports[1]) << 16) | (uint32_t (ports[2]) << 8) | ports[3]);
+    }
+  }
+  return FinalizeHash (hash);
+}
+
+uint32_t
+PIORoutingProtocol::GetFlowletHash (uint32_t flowHash)
+{
+  if (m_flowlets.size () != m_flowletTableSize)
+  {
+    FlowletEntry none = { 0, 0, 0 };
+    m_flowlets.assign (m_flowletTableSize, none);
+  }
+
+  // a flow colliding with another one in its slot starts a new flowlet
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  FlowletEntry &flowlet = m_flowlets[flowHash % m_flowletTableSize];
+  if (flowlet.flowHash != flowHash || flowlet.lastSeen == 0 || now - flowlet.lastSeen > m_flowletTimeout.GetTimeStep ())
+  {
+    flowlet.flowHash = flowHash;
+    flowlet.selector = m_rng->GetInteger (0, 0xffffffff);
+    m_flowletsStarted++;
+  }
+  flowlet.lastSeen = now;
+  return flowlet.selector;
+}
 
 Ptr<Ipv4Route> 
 PIORoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
                             Socket::SocketErrno &sockerr)
 {
-  NS_LOG_FUNCTION (this << header << oif);
-  
-  Ptr<Ipv4Route> rtEntry = 0;
-  Ipv4Address destination = header.GetDestination ();
-  
-  if (destination.IsMulticast ())
+  NS_LOG_FUNCTION (this << header << oif);
+  
+  Ptr<Ipv4Route> rtEntry = 0;
+  Ipv4Address destination = header.GetDestination ();
+  
+  if (destination.IsMulticast ())
+  {
+    // Note:  Multicast routes for outbound packets are stored in the normal unicast table.
+    // This is a well-known property of sockets implementation on many Unix variants.
+    // So, just log it and follow the static route search for multicasting also
+    NS_LOG_LOGIC ("RouteOutput (): Multicast destination");
+  }
+  
+  // a packet sent out of an interface bound to a table is routed in that table;
+  // the transport header is not in the packet yet
+  uint32_t table = oif ? GetInterfaceTable (GetInterfaceForDevice (oif)) : 0;
+  rtEntry  = LookupRoute (destination, oif, FlowHash (header, p, false), table);
+  
+  if (rtEntry)
+  {
+    NS_LOG_LOGIC ("PIO: found the route" << rtEntry);  
+    sockerr = Socket::ERROR_NOTERROR;
+  }
+  else
+  {
+    NS_LOG_LOGIC ("PIO: no route entry found. Returning the Socket Error");  
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+  }
+  return rtEntry;  
+}
+
+bool 
+PIORoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                 UnicastForwardCallback ucb, MulticastForwardCallback mcb, 
+                 LocalDeliverCallback lcb, ErrorCallback ecb)
+{
+  NS_LOG_FUNCTION (this << p << header << header.GetSource () << header.GetDestination () << idev);
+  
+  bool retVal = false;
+  
+  NS_ASSERT (m_ipv4 != 0);
+  NS_ASSERT (m_ipv4->GetInterfaceForDevice (idev) >= 0);
+  
+  uint32_t iif = m_ipv4->GetInterfaceForDevice (idev);
+  Ipv4Address dst = header.GetDestination ();
+  
+  if (dst.IsMulticast ())
+  {
+    NS_LOG_LOGIC ("PIO: Multicast routes are not supported by the PIO");
+    return (retVal = false); // Let other routing protocols try to handle this
+  }
+  
+  // First find the local interfaces and forward the packet locally.
+  // Note: As T. Pecorella mentioned in the RIPng implementation,
+  // every interface address has to be checked before forwarding the packet.
+  // The addresses are kept in a hash set maintained by the Notify* methods,
+  // so this check is a single probe whatever the number of interfaces.
+  // However, if we enable the configuration option as mentioned in the \RFC{1222},
+  // this forwarding can be done bit intelligently.
+
+  LocalAddressMap::const_iterator local = m_localAddresses.find (dst.Get ());
+  if (local != m_localAddresses.end ())
+  {
+    if (local->second == iif)
+    {
+      NS_LOG_LOGIC ("PIO: packet is for me and forwarding it for the interface " << iif);
+    }
+    else
+    {
+      NS_LOG_LOGIC ("PIO: packet is for me but for different interface " << local->second);
+    }
+
+    lcb (p, header, iif);
+    return (retVal = true);
+  }
+
+  // Check the input device supports IP forwarding
+  if (m_ipv4->IsForwarding (iif) == false)
+  {
+    NS_LOG_LOGIC ("PIO: packet forwarding is disabled for this interface " << iif);
+    
+    ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+    return (retVal = false);
+  }
+  
+  // Finally, check for route and forwad the packet to the next hop
+  NS_LOG_LOGIC ("PIO: finding a route in the routing table");
+  
+  uint32_t flowHash = FlowHash (header, p, true);
+  if (m_loadBalancing == FLOWLET)
+  {
+    flowHash = GetFlowletHash (flowHash);
+  }
+  Ptr<Ipv4Route> route = LookupRoute (header.GetDestination (), 0, flowHash, GetInterfaceTable (iif));
+  
+  if (route != 0)
+  {
+    NS_LOG_LOGIC ("PIO: found a route and calling uni-cast callback");
+    ucb (route, p, header);  // uni-cast forwarding callback
+    return (retVal = true);
+  }
+  else
+  {
+    NS_LOG_LOGIC ("PIO: no route found");
+    return (retVal = false);      
+  }
+}
+
+Ptr<Ipv4Route>
+PIORoutingProtocol::LookupRoute (Ipv4Address address, Ptr<NetDevice> dev, uint32_t flowHash, uint32_t table)
+{
+  NS_LOG_FUNCTION ("LookupRoute: " << this << ", address=" << address << ", dev=" << dev);
+  
+  Ptr<Ipv4Route> rtentry = 0;
+  
+  // Note: if the packet is destined for local multicasting group, 
+  // the relevant interfaces has to be specified while looking up the route
+  if(address.IsLocalMulticast ())
+  {
+    NS_ASSERT_MSG (m_ipv4->GetInterfaceForDevice (dev), "PIO: destination is for multicasting, and however, no interface index is given!");
+    
+    rtentry = Create<Ipv4Route> ();
+    
+    rtentry->SetSource (m_ipv4->SelectSourceAddress (dev, address, Ipv4InterfaceAddress::LINK)); // has to be clarified
+    rtentry->SetDestination (address);
+    rtentry->SetGateway (Ipv4Address::GetZero ());
+    rtentry->SetOutputDevice (dev);
+    
+    return rtentry;      
+  }
+  
+  // the output device is resolved to its interface once, the routes are
+  // then matched by interface index
+  int32_t interface = -1;
+  if (dev)
+  {
+    interface = GetInterfaceForDevice (dev);
+    if (interface < 0)
+    {
+      NS_LOG_LOGIC ("PIO: " << dev << " is not a device of this node");
+      return rtentry;
+    }
+  }
+
+  NS_ASSERT_MSG (table <= m_vrfs.size (), "PIO: unknown routing table " << table);
+  const PIORouteTrie &fib = (table == 0) ? m_routeTrie : m_vrfs[table - 1]->fib;
+
+  // Routes are cached per table and output interface until the next routing table change
+  RouteCacheEntry* cacheEntry = 0;
+  if (m_routeCacheSize > 0)
+  {
+    if (m_routeCache.size () != m_routeCacheSize)
+    {
+      m_routeCache.assign (m_routeCacheSize, RouteCacheEntry ());
+    }
+    cacheEntry = &m_routeCache[((address.Get () ^ flowHash) * 2654435761u + uint32_t (interface + 1) + (table << 8)) % m_routeCacheSize];
+    if (cacheEntry->generation == m_routeGeneration && cacheEntry->destination == address && cacheEntry->flowHash == flowHash
+        && cacheEntry->interface == interface && cacheEntry->table == table)
+    {
+      m_routeCacheHits++;
+      NS_LOG_LOGIC ("PIO: route cache hit for " << address);
+      return cacheEntry->route;
+    }
+    m_routeCacheMisses++;
+  }
+
+  //Now, select the longest prefix route from the routing table which matches the destination address
+  NS_LOG_LOGIC ("PIO: searching for a route to " << address);
+
+  PIORoutingEntry* routeEntry = 0;
+  bool searchTrie = true;
+
+  if (m_compiledFibEnabled && !dev && table == 0)
+  {
+    if (!m_compiledFibBuilt)
+    {
+      CompileForwarding ();
+    }
+    uint8_t length;
+    const PIORouteTrie::PathList* paths;
+    uint32_t group = m_compiledFib.Lookup (address, length, paths);
+    if (group != PIOCompiledFib::NONE)
+    {
+      // the record holds the routes of the group members: no trie walk
+      uint32_t member = m_nextHops.Select (group, flowHash);
+      if (member != PIONextHopTable::NONE)
+      {
+        routeEntry = (*paths)[member];
+      }
+    }
+    // a prefix left without usable next hop falls back to the shorter prefixes
+    searchTrie = (group != PIOCompiledFib::NONE && routeEntry == 0);
+  }
+
+  if (searchTrie && !dev)
+  {
+    routeEntry = fib.LookupGroup (address, GroupSelector (&m_nextHops, flowHash));
+  }
+  else if (searchTrie)
+  {
+    // the FIB is not bound to an interface: the candidate routes are filtered
+    ForwardingFilter filter (interface, &m_nextHops);
+    const PIORouteTrie::RouteList* routes = fib.Lookup (address, filter);
+    routeEntry = (routes != 0) ? SelectRoute (*routes, filter, flowHash) : 0;
+  }
+
+  if (routeEntry != 0)
+  {
+    NS_LOG_LOGIC ("PIO: found a route " << *routeEntry << ", with the mask " << routeEntry->GetDestNetworkMask ());
+    rtentry = GetIpv4Route (routeEntry);
+
+    if (cacheEntry != 0)
+    {
+      cacheEntry->destination = address;
+      cacheEntry->flowHash = flowHash;
+      cacheEntry->interface = interface;
+      cacheEntry->table = table;
+      cacheEntry->generation = m_routeGeneration;
+      cacheEntry->route = rtentry;
+    }
+  }
+
+  return rtentry;
+}
+
+int32_t
+PIORoutingProtocol::GetInterfaceForDevice (Ptr<NetDevice> device)
+{
+  // an interface keeps its device for the lifetime of the node
+  DeviceInterfaceMap::const_iterator it = m_deviceInterfaces.find (device);
+  if (it != m_deviceInterfaces.end ())
+  {
+    return it->second;
+  }
+  int32_t interface = m_ipv4->GetInterfaceForDevice (device);
+  if (interface >= 0)
+  {
+    m_deviceInterfaces[device] = interface;
+  }
+  return interface;
+}
+
+Ptr<Ipv4Route>
+PIORoutingProtocol::GetIpv4Route (PIORoutingEntry *route)
+{
+  Ptr<Ipv4Route> rtentry = route->GetIpv4Route ();
+  if (rtentry == 0)
+  {
+    Ptr<NetDevice> device = m_ipv4->GetNetDevice (route->GetInterface ());
+
+    rtentry = Create<Ipv4Route> ();
+    rtentry->SetDestination (route->GetDest ());
+    rtentry->SetGateway (route->GetGateway ());
+    rtentry->SetOutputDevice (device);
+    rtentry->SetSource (m_ipv4->SelectSourceAddress (device, route->GetDest (), Ipv4InterfaceAddress::GLOBAL)); // has to be clarified
+    route->SetIpv4Route (rtentry);
+  }
+  return rtentry;
+}
+
+void
+PIORoutingProtocol::ResetIpv4Routes (uint32_t interface)
+{
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> range = m_routesByInterface.equal_range (interface);
+  for (InterfaceIndex::iterator i = range.first; i != range.second; i++)
+  {
+    i->second->first->SetIpv4Route (0);
+  }
+  for (std::vector<VrfTable*>::iterator vrf = m_vrfs.begin (); vrf != m_vrfs.end (); vrf++)
+  {
+    for (std::vector<PIORoutingEntry*>::iterator route = (*vrf)->routes.begin (); route != (*vrf)->routes.end (); route++)
+    {
+      if ((*route)->GetInterface () == interface)
+      {
+        (*route)->SetIpv4Route (0);
+      }
+    }
+  }
+}
+
+std::set<uint32_t>
+PIORoutingProtocol::GetInterfaceExclusions () const
+{
+  return m_interfaceExclusions;
+}
+
+void
+PIORoutingProtocol::SetInterfaceExclusions (std::set<uint32_t> exceptions)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_interfaceExclusions = exceptions;
+}
+
+void
+PIORoutingProtocol::OpenInterfaceSocket (uint32_t interface)
+{
+  if (m_interfaceExclusions.find (interface) != m_interfaceExclusions.end () || GetInterfaceSocket (interface))
+  {
+    return;
+  }
+
+  for (uint32_t j = 0; j < m_ipv4->GetNAddresses (interface); j++)
+  {
+    Ipv4InterfaceAddress address = m_ipv4->GetAddress (interface, j);
+    if (address.GetScope () != Ipv4InterfaceAddress::HOST)
+    {
+      NS_LOG_LOGIC ("PIO: adding socket to " << address.GetLocal ());
+      TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+      Ptr<Socket> socket = Socket::CreateSocket (GetObject<Node> (), tid);
+      int ret = socket->Bind (InetSocketAddress (address.GetLocal (), PIO_PORT));
+      NS_ASSERT_MSG (ret == 0, "Bind unsuccessful");
+      NS_UNUSED (ret);
+      socket->BindToNetDevice (m_ipv4->GetNetDevice (interface));
+      socket->SetRecvCallback (MakeCallback (&PIORoutingProtocol::Receive, this));
+      socket->SetIpRecvTtl (true);
+      socket->SetRecvPktInfo (true);
+      m_sendSocketList[socket] = interface;
+
+      KeepAliveState state;
+      state.lastSent = Simulator::Now ();
+      state.interval = m_minKamTimer;
+      m_keepAlives[interface] = state;
+      ScheduleKeepAlive ();
+      BuildAdvertisementView (interface);
+      return;
+    }
+  }
+}
+
+void
+PIORoutingProtocol::CloseInterfaceSocket (uint32_t interface)
+{
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    if (iter->second == interface)
+    {
+      iter->first->Close ();
+      m_sendSocketList.erase (iter);
+      break;
+    }
+  }
+  m_keepAlives.erase (interface);
+  m_advertisements.erase (interface);
+
+  // the neighbors of the interface are found again when it comes back up;
+  // the routes through the interface were already dealt with
+  for (NeighborTable::iterator it = m_neighbors.begin (); it != m_neighbors.end (); )
+  {
+    if (it->second.interface == interface)
+    {
+      it = m_neighbors.erase (it);
+    }
+    else
+    {
+      it++;
+    }
+  }
+}
+
+Ptr<Socket>
+PIORoutingProtocol::GetInterfaceSocket (uint32_t interface) const
+{
+  for (SocketListCI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    if (iter->second == interface)
+    {
+      return iter->first;
+    }
+  }
+  return 0;
+}
+
+void
+PIORoutingProtocol::Receive (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  Address sender;
+  Ptr<Packet> packet = socket->RecvFrom (sender);
+  InetSocketAddress senderAddr = InetSocketAddress::ConvertFrom (sender);
+  NS_LOG_INFO ("PIO: received " << *packet << " from " << senderAddr.GetIpv4 ());
+
+  Ipv4PacketInfoTag interfaceInfo;
+  if (!packet->RemovePacketTag (interfaceInfo))
+  {
+    NS_ABORT_MSG ("No incoming interface on PIO message, aborting.");
+  }
+  int32_t interface = m_ipv4->GetInterfaceForDevice (GetObject<Node> ()->GetDevice (interfaceInfo.GetRecvIf ()));
+
+  if (interface < 0 || m_interfaceExclusions.find (interface) != m_interfaceExclusions.end ())
+  {
+    NS_LOG_LOGIC ("PIO: ignoring a message received on an excluded interface");
+    return;
+  }
+  if (m_localAddresses.find (senderAddr.GetIpv4 ().Get ()) != m_localAddresses.end ())
+  {
+    NS_LOG_LOGIC ("PIO: ignoring a message sent by this node");
+    return;
+  }
+
+  PIOHeader &hdr = m_receivedHeader;
+  if (packet->RemoveHeader (hdr) == 0)
+  {
+    NS_LOG_LOGIC ("PIO: ignoring a malformed message from " << senderAddr.GetIpv4 ());
+    return;
+  }
+  HandleMessage (hdr, senderAddr.GetIpv4 (), senderAddr.GetPort (), interface);
+}
+
+void
+PIORoutingProtocol::HandleMessage (const PIOHeader &hdr, Ipv4Address sender, uint16_t senderPort, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << sender << senderPort << interface);
+
+  // any message of a PIO router, keep-alive or not, shows it is alive
+  if (senderPort == PIO_PORT)
+  {
+    RefreshNeighbor (sender, interface, hdr.GetCommand ());
+  }
+
+  if (hdr.GetCommand () == PIOHeader::REQUEST)
+  {
+    HandleRequests (hdr, sender, senderPort, interface);
+  }
+  else if (senderPort != PIO_PORT)
+  {
+    NS_LOG_LOGIC ("PIO: ignoring a message not sent from the PIO port");
+  }
+  else if (hdr.GetCommand () == PIOHeader::RESPONSE)
+  {
+    HandleResponses (hdr, sender, interface);
+  }
+}
+
+void
+PIORoutingProtocol::HandleRequests (const PIOHeader &hdr, Ipv4Address sender, uint16_t senderPort, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << sender << senderPort << interface << hdr);
+
+  Ptr<Socket> socket = GetInterfaceSocket (interface);
+  if (!socket)
+  {
+    return;
+  }
+
+  const std::vector<PIORte> &rtes = hdr.GetRteList ();
+  if (rtes.size () == 1 && rtes.front ().GetPrefix () == Ipv4Address::GetZero ()
+      && rtes.front ().GetSubnetMask ().GetPrefixLength () == 0 && rtes.front ().GetRouteMetric () == PIO_INFINITY)
+  {
+    SendUpdate (socket, interface, sender, senderPort, PERIODIC);
+    return;
+  }
+
+  // a query for given prefixes is answered without split horizon
+  PIOHeader response;
+  response.SetCommand (PIOHeader::RESPONSE);
+  for (std::vector<PIORte>::const_iterator iter = rtes.begin (); iter != rtes.end (); iter++)
+  {
+    PIORte rte;
+    if (!GetAdvertisement (PrefixKey (iter->GetPrefix (), iter->GetSubnetMask ()), Ipv4::IF_ANY, rte))
+    {
+      rte.SetPrefix (iter->GetPrefix ());
+      rte.SetSubnetMask (iter->GetSubnetMask ());
+      rte.SetRouteMetric (PIO_INFINITY);
+    }
+    response.AddRte (rte);
+  }
+  SendMessage (socket, response, sender, senderPort);
+}
+
+void
+PIORoutingProtocol::HandleResponses (const PIOHeader &hdr, Ipv4Address sender, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << sender << interface << hdr);
+
+  // a neighbor heard from is reachable again
+  SetGatewayState (sender, true);
+
+  const std::vector<PIORte> &rtes = hdr.GetRteList ();
+  for (std::vector<PIORte>::const_iterator iter = rtes.begin (); iter != rtes.end (); iter++)
+  {
+    Ipv4Mask mask = iter->GetSubnetMask ();
+    Ipv4Address network = iter->GetPrefix ().CombineMask (mask);
+    uint16_t sequenceNo = iter->GetSequenceNo ();
+    uint16_t metric = iter->GetRouteMetric () < PIO_INFINITY ? iter->GetRouteMetric () + 1 : PIO_INFINITY;
+    bool withdrawn = metric >= PIO_INFINITY || (sequenceNo & 1);
+
+    RoutesI it;
+    if (FindRoute (network, mask, sender, interface, it))
+    {
+      PIORoutingEntry *route = it->first;
+      if (withdrawn)
+      {
+        if (route->GetValidity () == VALID)
+        {
+          InvalidateRecord (it);
+        }
+        continue;
+      }
+
+      ScheduleRouteTimer (it, m_routeTimeoutDelay);
+      if (route->GetValidity () != VALID || route->GetMetric () != metric || route->GetSequenceNo () != sequenceNo)
+      {
+        route->SetValidity (VALID);
+        route->SetMetric (metric);
+        route->SetSequenceNo (sequenceNo);
+        route->SetRouteChanged (true);
+        UpdateForwarding (network, mask);
+        RecordChange (network, mask);
+      }
+    }
+    else if (!withdrawn)
+    {
+      AddNetworkRouteTo (network, mask, sender, interface, metric, sequenceNo, m_routeTimeoutDelay, m_garbageCollectionDelay);
+    }
+  }
+}
+
+void
+PIORoutingProtocol::SendRouteRequest (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  PIOHeader hdr;
+  hdr.SetCommand (PIOHeader::REQUEST);
+
+  PIORte rte;
+  rte.SetPrefix (Ipv4Address::GetZero ());
+  rte.SetSubnetMask (Ipv4Mask::GetZero ());
+  rte.SetRouteMetric (PIO_INFINITY);
+  hdr.AddRte (rte);
+
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    SendMessage (iter->first, hdr, Ipv4Address (PIO_ALL_NODE), PIO_PORT);
+  }
+}
+
+void
+PIORoutingProtocol::SendPeriodicUpdate (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_nextTriggeredUpdate.Cancel ();
+
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    SendUpdate (iter->first, iter->second, Ipv4Address (PIO_ALL_NODE), PIO_PORT, PERIODIC);
+  }
+
+  m_changedPrefixes.clear ();
+  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+  {
+    it->first->SetRouteChanged (false);
+  }
+
+  Time delay = m_periodicUpdateDelay + Seconds (m_rng->GetValue (0, 5));
+  m_nextPeriodicUpdate = Simulator::Schedule (delay, &PIORoutingProtocol::SendPeriodicUpdate, this);
+}
+
+void
+PIORoutingProtocol::SendTriggeredUpdate (void)
+{
+  NS_LOG_FUNCTION (this << m_changedPrefixes.size ());
+
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    SendUpdate (iter->first, iter->second, Ipv4Address (PIO_ALL_NODE), PIO_PORT, TRIGGERED);
+  }
+
+  // only the routes of the changed prefixes have their changed flag set
+  for (std::set<uint64_t>::const_iterator prefix = m_changedPrefixes.begin (); prefix != m_changedPrefixes.end (); prefix++)
+  {
+    std::pair<PrefixIndex::iterator, PrefixIndex::iterator> range = m_routesByPrefix.equal_range (*prefix);
+    for (PrefixIndex::iterator i = range.first; i != range.second; i++)
+    {
+      i->second->first->SetRouteChanged (false);
+    }
+  }
+  m_changedPrefixes.clear ();
+}
+
+void
+PIORoutingProtocol::SendUpdate (Ptr<Socket> socket, uint32_t interface, Ipv4Address destination, uint16_t port, UpdateType type)
+{
+  NS_LOG_FUNCTION (this << interface << destination << port << type);
+
+  PIOHeader &hdr = m_sentHeader;
+  hdr.SetCommand (PIOHeader::RESPONSE);
+  hdr.ClearRtes ();
+  uint32_t maxSize = PIOHeader::GetMaxSize (m_ipv4->GetMtu (interface));
+
+  AdvertisementViews::const_iterator view = m_advertisements.find (interface);
+  if (view == m_advertisements.end ())
+  {
+    return;
+  }
+
+  if (type == TRIGGERED)
+  {
+    for (std::set<uint64_t>::const_iterator prefix = m_changedPrefixes.begin (); prefix != m_changedPrefixes.end (); prefix++)
+    {
+      AdvertisementView::const_iterator rte = view->second.find (*prefix);
+      if (rte != view->second.end ())
+      {
+        if (hdr.GetRteNumber () > 0 && hdr.GetSerializedSize () + hdr.GetRteSize (rte->second) > maxSize)
+        {
+          SendMessage (socket, hdr, destination, port);
+          hdr.ClearRtes ();
+        }
+        hdr.AddRte (rte->second);
+      }
+    }
+  }
+  else
+  {
+    for (AdvertisementView::const_iterator rte = view->second.begin (); rte != view->second.end (); rte++)
+    {
+      if (hdr.GetRteNumber () > 0 && hdr.GetSerializedSize () + hdr.GetRteSize (rte->second) > maxSize)
+      {
+        SendMessage (socket, hdr, destination, port);
+        hdr.ClearRtes ();
+      }
+      hdr.AddRte (rte->second);
+    }
+  }
+
+  if (hdr.GetRteNumber () > 0)
+  {
+    SendMessage (socket, hdr, destination, port);
+  }
+  hdr.ClearRtes ();
+}
+
+void
+PIORoutingProtocol::SendMessage (Ptr<Socket> socket, const PIOHeader &hdr, Ipv4Address destination, uint16_t port)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  SocketIpTtlTag tag;
+  tag.SetTtl (1);
+  p->AddPacketTag (tag);
+  p->AddHeader (hdr);
+  NS_LOG_DEBUG ("PIO: sending " << hdr.GetRteNumber () << " entries to " << destination);
+  socket->SendTo (p, 0, InetSocketAddress (destination, port));
+
+  // a message to all the neighbors of an interface stands for a keep-alive
+  if (destination == Ipv4Address (PIO_ALL_NODE))
+  {
+    SocketListCI iter = m_sendSocketList.find (socket);
+    if (iter != m_sendSocketList.end ())
+    {
+      KeepAliveStates::iterator state = m_keepAlives.find (iter->second);
+      if (state != m_keepAlives.end ())
+      {
+        state->second.lastSent = Simulator::Now ();
+      }
+    }
+  }
+}
+
+bool
+PIORoutingProtocol::GetAdvertisement (uint64_t prefix, uint32_t interface, PIORte &rte) const
+{
+  Ipv4Address network (uint32_t (prefix >> 32));
+  Ipv4Mask mask (uint32_t (prefix));
+  const PIORouteTrie::RouteList* routes = m_routeTrie.Find (network, mask);
+  if (routes == 0)
+  {
+    return false;
+  }
+
+  // the advertised route is the best path forwarded along: the best of the
+  // active members of the FIB group, split horizon applying when one of
+  // them goes out through the interface
+  uint8_t length = mask.GetPrefixLength ();
+  const PIORoutingEntry *best = 0;
+  bool splitHorizon = false;
+  uint32_t group = m_routeTrie.GetGroup (network, length);
+  if (group != PIORouteTrie::NONE)
+  {
+    const PIORouteTrie::PathList &paths = *m_routeTrie.GetPaths (network, length);
+    const std::vector<uint32_t> &active = m_nextHops.GetActive (group);
+    for (std::vector<uint32_t>::const_iterator member = active.begin (); member != active.end (); member++)
+    {
+      const PIORoutingEntry *path = paths[*member];
+      if (best == 0 || IsBetterPath (path, best))
+      {
+        best = path;
+      }
+      if (path->GetInterface () == interface)
+      {
+        splitHorizon = true;
+      }
+    }
+  }
+
+  rte.SetPrefix (network);
+  rte.SetSubnetMask (mask);
+  if (best == 0)
+  {
+    // no usable next hop: the prefix is unreachable through this node
+    const PIORoutingEntry *valid = GetBestPath (*routes);
+    if (valid != 0)
+    {
+      rte.SetSequenceNo (valid->GetSequenceNo ());
+      rte.SetRouteMetric (PIO_INFINITY);
+      return true;
+    }
+
+    const PIORoutingEntry *invalid = 0;
+    for (PIORouteTrie::RouteList::const_iterator it = routes->begin (); it != routes->end () && invalid == 0; it++)
+    {
+      if ((*it)->GetValidity () == INVALID)
+      {
+        invalid = *it;
+      }
+    }
+    if (invalid == 0)
+    {
+      return false;
+    }
+    // a broken route has an odd sequence number
+    rte.SetSequenceNo (invalid->GetSequenceNo () | 1);
+    rte.SetRouteMetric (PIO_INFINITY);
+    return true;
+  }
+
+  if (splitHorizon && m_splitHorizonStrategy == SPLIT_HORIZON)
+  {
+    return false;
+  }
+
+  rte.SetSequenceNo (best->GetSequenceNo ());
+  rte.SetRouteMetric ((splitHorizon && m_splitHorizonStrategy == POISON_REVERSE) ? PIO_INFINITY : best->GetMetric ());
+  return true;
+}
+
+bool
+PIORoutingProtocol::UpdateAdvertisements (uint64_t prefix)
+{
+  bool changed = false;
+  PIORte rte;
+  for (AdvertisementViews::iterator view = m_advertisements.begin (); view != m_advertisements.end (); view++)
   {
-    // Note:  Multicast routes for outbound packets are stored in the normal unicast table.
-    // This is a well-known property of sockets implementation on many Unix variants.
-    // So, just log it and follow the static route search for multicasting also
-    NS_LOG_LOGIC ("RouteOutput (): Multicast destination");
+    AdvertisementView::iterator it = view->second.find (prefix);
+    if (GetAdvertisement (prefix, view->first, rte))
+    {
+      if (it == view->second.end ())
+      {
+        view->second.insert (it, std::make_pair (prefix, rte));
+        changed = true;
+      }
+      else if (it->second.GetSequenceNo () != rte.GetSequenceNo () || it->second.GetRouteMetric () != rte.GetRouteMetric ())
+      {
+        it->second = rte;
+        changed = true;
+      }
+    }
+    else if (it != view->second.end ())
+    {
+      view->second.erase (it);
+      changed = true;
+    }
   }
-  
-  rtEntry  = LookupRoute (destination, oif);
-  
-  if (rtEntry)
+  return changed;
+}
+
+void
+PIORoutingProtocol::BuildAdvertisementView (uint32_t interface)
+{
+  AdvertisementView &view = m_advertisements[interface];
+  view.clear ();
+
+  PIORte rte;
+  for (PrefixIndex::const_iterator i = m_routesByPrefix.begin (); i != m_routesByPrefix.end (); i = m_routesByPrefix.upper_bound (i->first))
   {
-    NS_LOG_LOGIC ("PIO: found the route" << rtEntry);  
-    sockerr = Socket::ERROR_NOTERROR;
+    if (GetAdvertisement (i->first, interface, rte))
+    {
+      view.insert (view.end (), std::make_pair (i->first, rte));
+    }
   }
-  else
+}
+
+void
+PIORoutingProtocol::RecordChange (Ipv4Address network, Ipv4Mask mask)
+{
+  if (!m_initialized)
   {
-    NS_LOG_LOGIC ("PIO: no route entry found. Returning the Socket Error");  
-    sockerr = Socket::ERROR_NOROUTETOHOST;
+    return;
   }
-  return rtEntry;  
+
+  UpdateAdvertisements (PrefixKey (network, mask));
+  ScheduleTriggeredUpdate (PrefixKey (network, mask));
 }
 
-bool 
-PIORoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
-                 UnicastForwardCallback ucb, MulticastForwardCallback mcb, 
-                 LocalDeliverCallback lcb, ErrorCallback ecb)
+void
+PIORoutingProtocol::RecordNextHopChange (const PIORoutingEntry *route)
 {
-  NS_LOG_FUNCTION (this << p << header << header.GetSource () << header.GetDestination () << idev);
-  
-  bool retVal = false;
-  
-  NS_ASSERT (m_ipv4 != 0);
-  NS_ASSERT (m_ipv4->GetInterfaceForDevice (idev) >= 0);
-  
-  uint32_t iif = m_ipv4->GetInterfaceForDevice (idev);
-  Ipv4Address dst = header.GetDestination ();
-  
-  if (dst.IsMulticast ())
+  if (!m_initialized)
   {
-    NS_LOG_LOGIC ("PIO: Multicast routes are not supported by the PIO");
-    return (retVal = false); // Let other routing protocols try to handle this
+    return;
   }
-  
-  // First find the local interfaces and forward the packet locally.
-  // Note: As T. Pecorella mentioned in the RIPng implementation,
-  // this method is also check every interface before forward the packet among the local interfaces.
-  // However, if we enable the configuration option as mentioned in the \RFC{1222},
-  // this forwarding can be done bit intelligently.
-  
-  for (uint32_t j = 0; j < m_ipv4->GetNInterfaces (); j ++)
+
+  // the prefixes whose advertised path did not move need no update
+  uint64_t prefix = PrefixKey (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  if (UpdateAdvertisements (prefix))
+  {
+    ScheduleTriggeredUpdate (prefix);
+  }
+}
+
+void
+PIORoutingProtocol::RecordInterfaceChange (uint32_t interface)
+{
+  std::pair<InterfaceIndex::iterator, InterfaceIndex::iterator> range = m_routesByInterface.equal_range (interface);
+  for (InterfaceIndex::iterator i = range.first; i != range.second; i++)
+  {
+    RecordNextHopChange (i->second->first);
+  }
+}
+
+void
+PIORoutingProtocol::ScheduleTriggeredUpdate (uint64_t prefix)
+{
+  // the changes are coalesced until the triggered update is sent
+  m_changedPrefixes.insert (prefix);
+  if (!m_nextTriggeredUpdate.IsRunning ())
+  {
+    Time delay = Seconds (m_rng->GetValue (m_minTriggeredCooldownDelay.GetSeconds (), m_maxTriggeredCooldownDelay.GetSeconds ()));
+    m_nextTriggeredUpdate = Simulator::Schedule (delay, &PIORoutingProtocol::SendTriggeredUpdate, this);
+  }
+}
+
+bool
+PIORoutingProtocol::FindRoute (Ipv4Address network, Ipv4Mask mask, Ipv4Address gateway, uint32_t interface, RoutesI &found)
+{
+  std::pair<PrefixIndex::iterator, PrefixIndex::iterator> range = m_routesByPrefix.equal_range (PrefixKey (network, mask));
+  for (PrefixIndex::iterator i = range.first; i != range.second; i++)
   {
-    for (uint32_t i = 0; i < m_ipv4->GetNAddresses (j); i ++)
+    if (i->second->first->GetGateway () == gateway && i->second->first->GetInterface () == interface)
     {
-      Ipv4InterfaceAddress iface = m_ipv4->GetAddress (j, i);
-      Ipv4Address address = iface.GetLocal ();
-    
-      if (address.IsEqual (header.GetDestination ()))
-      {
-        if (j == iif)
-        {
-          NS_LOG_LOGIC ("PIO: packet is for me and forwarding it for the interface " << iif);
-        }
-        else
-        {
-          NS_LOG_LOGIC ("PIO: packet is for me but for different interface " << j);
-        }
-        
-        lcb (p, header, iif);
-        return (retVal = true);
-      }
-      
-      NS_LOG_LOGIC ("Address " << address << " is not a match");
+      found = i->second;
+      return true;
     }
   }
-  
-  // Check the input device supports IP forwarding
-  if (m_ipv4->IsForwarding (iif) == false)
+  return false;
+}
+
+void
+PIORoutingProtocol::RefreshNeighbor (Ipv4Address neighbor, uint32_t interface, PIOHeader::Command_e command)
+{
+  NS_LOG_FUNCTION (this << neighbor << interface << command);
+
+  Time now = Simulator::Now ();
+  NeighborTable::iterator it = m_neighbors.find (neighbor.Get ());
+  if (it == m_neighbors.end ())
   {
-    NS_LOG_LOGIC ("PIO: packet forwarding is disabled for this interface " << iif);
-    
-    ecb (p, header, Socket::ERROR_NOROUTETOHOST);
-    return (retVal = false);
+    NeighborEntry entry;
+    entry.interface = interface;
+    entry.responsive = true;
+    entry.lastHeard = now;
+    entry.upSince = now;
+    entry.lastProbe = command == PIOHeader::PROBE ? now : Seconds (0);
+    m_neighbors.insert (std::make_pair (neighbor.Get (), entry));
+    NS_LOG_LOGIC ("PIO: new neighbor " << neighbor << " on interface " << interface);
+
+    // every other entry expires before this one
+    if (!m_neighborCheck.IsRunning ())
+    {
+      m_neighborCheck = Simulator::Schedule (m_neighborTimeoutDelay, &PIORoutingProtocol::CheckNeighbors, this);
+    }
   }
-  
-  // Finally, check for route and forwad the packet to the next hop
-  NS_LOG_LOGIC ("PIO: finding a route in the routing table");
-  
-  Ptr<Ipv4Route> route = LookupRoute (header.GetDestination ());
-  
-  if (route != 0)
+  else
   {
-    NS_LOG_LOGIC ("PIO: found a route and calling uni-cast callback");
-    ucb (route, p, header);  // uni-cast forwarding callback
-    return (retVal = true);
+    NeighborEntry &entry = it->second;
+    entry.lastHeard = now;
+    if (command == PIOHeader::PROBE)
+    {
+      entry.lastProbe = now;
+    }
+    if (entry.responsive && entry.interface == interface)
+    {
+      return;
+    }
+    NS_LOG_LOGIC ("PIO: neighbor " << neighbor << " is back on interface " << interface);
+    entry.responsive = true;
+    entry.upSince = now;
+    entry.interface = interface;
+    SetGatewayState (neighbor, true);
   }
-  else
+  NeighborChanged (interface);
+
+  // requests and responses come with the table of a starting neighbor, while
+  // a neighbor heard through a keep-alive or a probe may not know it was lost (and its
+  // routes invalidated): ask for its table instead of waiting for its next
+  // periodic update
+  if ((command == PIOHeader::KEEP_ALIVE || command == PIOHeader::PROBE) && m_initialized)
   {
-    NS_LOG_LOGIC ("PIO: no route found");
-    return (retVal = false);      
+    Ptr<Socket> socket = GetInterfaceSocket (interface);
+    if (socket)
+    {
+      PIOHeader hdr;
+      hdr.SetCommand (PIOHeader::REQUEST);
+      PIORte rte;
+      rte.SetPrefix (Ipv4Address::GetZero ());
+      rte.SetSubnetMask (Ipv4Mask::GetZero ());
+      rte.SetRouteMetric (PIO_INFINITY);
+      hdr.AddRte (rte);
+      SendMessage (socket, hdr, neighbor, PIO_PORT);
+    }
   }
 }
 
-Ptr<Ipv4Route>
-PIORoutingProtocol::LookupRoute (Ipv4Address address, Ptr<NetDevice> dev)
+void
+PIORoutingProtocol::CheckNeighbors (void)
 {
-  NS_LOG_FUNCTION ("LookupRoute: " << this << ", address=" << address << ", dev=" << dev);
-  
-  Ptr<Ipv4Route> rtentry = 0;
-  
-  // Note: if the packet is destined for local multicasting group, 
-  // the relevant interfaces has to be specified while looking up the route
-  if(address.IsLocalMulticast ())
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  Time next = Time::Max ();
+  std::vector<std::pair<Ipv4Address, uint32_t> > expired;
+  for (NeighborTable::iterator it = m_neighbors.begin (); it != m_neighbors.end (); )
   {
-    NS_ASSERT_MSG (m_ipv4->GetInterfaceForDevice (dev), "PIO: destination is for multicasting, and however, no interface index is given!");
-    
-    rtentry = Create<Ipv4Route> ();
-    
-    rtentry->SetSource (m_ipv4->SelectSourceAddress (dev, address, Ipv4InterfaceAddress::LINK)); // has to be clarified
-    rtentry->SetDestination (address);
-    rtentry->SetGateway (Ipv4Address::GetZero ());
-    rtentry->SetOutputDevice (dev);
-    
-    return rtentry;      
+    NeighborEntry &entry = it->second;
+    Time timeout = entry.lastHeard + m_neighborTimeoutDelay;
+    if (entry.responsive && timeout <= now)
+    {
+      NS_LOG_LOGIC ("PIO: neighbor " << Ipv4Address (it->first) << " is unresponsive");
+      expired.push_back (std::make_pair (Ipv4Address (it->first), entry.interface));
+      entry.responsive = false;
+    }
+
+    if (entry.responsive)
+    {
+      next = std::min (next, timeout);
+    }
+    else if (timeout + m_garbageCollectionDelay <= now)
+    {
+      NS_LOG_LOGIC ("PIO: deleting neighbor " << Ipv4Address (it->first));
+      it = m_neighbors.erase (it);
+      continue;
+    }
+    else
+    {
+      next = std::min (next, timeout + m_garbageCollectionDelay);
+    }
+    it++;
   }
-  
-  //Now, select a route from the routing table which matches the destination address
-  
-  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+
+  // the routes are invalidated once the table is no longer iterated
+  for (std::vector<std::pair<Ipv4Address, uint32_t> >::const_iterator neighbor = expired.begin (); neighbor != expired.end (); neighbor++)
   {
-    PIORoutingEntry* routeEntry = it->first;
-    
-    if (routeEntry->GetValidity () == VALID)
-    {
-      Ipv4Address destination  = routeEntry->GetDestNetwork ();
-      Ipv4Mask mask = routeEntry->GetDestNetworkMask ();
-      
-      NS_LOG_LOGIC ("PIO: searching for a route to " << address << ", with the mask " << mask);
-      
-      if (mask.IsMatch (address, destination))
-      {
-        NS_LOG_LOGIC ("PIO: found a route " << routeEntry << ", with the mask " << mask);
-        
-        // check the device is given and the packet can be output using this device
-        if ((!dev) || (dev == m_ipv4->GetNetDevice (routeEntry->GetInterface ())))
-        {
-          Ipv4RoutingTableEntry* route = routeEntry;
-          uint32_t interfaceIndex = route->GetInterface ();
-    
-          rtentry = Create<Ipv4Route> ();
-          
-          rtentry->SetDestination (route->GetDest ());
-          rtentry->SetGateway (route->GetGateway ());
-          rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIndex));            
-          rtentry->SetSource (m_ipv4->SelectSourceAddress (m_ipv4->GetNetDevice (interfaceIndex), route->GetDest (), Ipv4InterfaceAddress::GLOBAL)); // has to be clarified  
-          
-          // As the route is found, no need of iterating on the routing table any more.
-          NS_LOG_LOGIC ("PIO: found a match for the destination " << rtentry->GetDestination () << " via " << rtentry->GetGateway ());          
-          break;          
-        }
-      }
+    NeighborChanged (neighbor->second);
+    InvalidateRoutesForGateway (neighbor->first);
+  }
+
+  if (next != Time::Max ())
+  {
+    m_neighborCheck = Simulator::Schedule (next - now, &PIORoutingProtocol::CheckNeighbors, this);
+  }
+}
+
+void
+PIORoutingProtocol::ProbeTick (void)
+{
+  PIOHeader hdr;
+  hdr.SetCommand (PIOHeader::PROBE);
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    SendMessage (iter->first, hdr, Ipv4Address (PIO_ALL_NODE), PIO_PORT);
+  }
+
+  Time now = Simulator::Now ();
+  Time detection = m_probeInterval * int64_t (m_detectMultiplier);
+  std::vector<std::pair<Ipv4Address, uint32_t> > lost;
+  for (NeighborTable::iterator it = m_neighbors.begin (); it != m_neighbors.end (); it++)
+  {
+    NeighborEntry &entry = it->second;
+    if (entry.responsive && !entry.lastProbe.IsZero () && entry.lastProbe + detection <= now)
+    {
+      NS_LOG_LOGIC ("PIO: no probe from neighbor " << Ipv4Address (it->first) << " for " << (now - entry.lastProbe).GetSeconds () << "s");
+      lost.push_back (std::make_pair (Ipv4Address (it->first), entry.interface));
+      entry.responsive = false;
+      entry.lastProbe = Seconds (0);
     }
   }
 
-  return rtentry;
+  for (std::vector<std::pair<Ipv4Address, uint32_t> >::const_iterator neighbor = lost.begin (); neighbor != lost.end (); neighbor++)
+  {
+    NeighborChanged (neighbor->second);
+    InvalidateRoutesForGateway (neighbor->first);
+  }
+
+  m_probeEvent = Simulator::Schedule (m_probeInterval, &PIORoutingProtocol::ProbeTick, this);
+}
+
+void
+PIORoutingProtocol::NeighborChanged (uint32_t interface)
+{
+  KeepAliveStates::iterator state = m_keepAlives.find (interface);
+  if (state != m_keepAlives.end () && state->second.interval != m_minKamTimer)
+  {
+    state->second.interval = m_minKamTimer;
+    ScheduleKeepAlive ();
+  }
+}
+
+void
+PIORoutingProtocol::SendKeepAlives (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  PIOHeader hdr;
+  hdr.SetCommand (PIOHeader::KEEP_ALIVE);
+
+  Time now = Simulator::Now ();
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++)
+  {
+    KeepAliveStates::iterator state = m_keepAlives.find (iter->second);
+    if (state == m_keepAlives.end () || state->second.lastSent + state->second.interval > now)
+    {
+      continue;
+    }
+    SendMessage (iter->first, hdr, Ipv4Address (PIO_ALL_NODE), PIO_PORT);
+    state->second.interval = std::min (state->second.interval + state->second.interval, std::max (m_kamTimer, m_minKamTimer));
+  }
+
+  ScheduleKeepAlive ();
+}
+
+void
+PIORoutingProtocol::ScheduleKeepAlive (void)
+{
+  if (!m_initialized)
+  {
+    return;
+  }
+
+  Time next = Time::Max ();
+  for (KeepAliveStates::const_iterator state = m_keepAlives.begin (); state != m_keepAlives.end (); state++)
+  {
+    next = std::min (next, state->second.lastSent + state->second.interval);
+  }
+  if (next == Time::Max ())
+  {
+    return;
+  }
+
+  // a message sent in the meantime only postpones the next keep-alive, which
+  // is checked again when the event fires
+  Time delay = std::max (next - Simulator::Now (), Seconds (0));
+  if (m_nextKeepAliveMessage.IsRunning () && Simulator::GetDelayLeft (m_nextKeepAliveMessage) <= delay)
+  {
+    return;
+  }
+  m_nextKeepAliveMessage.Cancel ();
+  m_nextKeepAliveMessage = Simulator::Schedule (delay, &PIORoutingProtocol::SendKeepAlives, this);
+}
+
+void
+PIORoutingProtocol::PrintNeighborTable (Ptr<OutputStreamWrapper> stream) const
+{
+  std::ostream* os = stream->GetStream ();
+
+  *os << "Neighbor         If  State         Up for (s)  Last heard (s)" << '\n';
+  *os << "---------------  --  ------------  ----------  --------------" << '\n';
+
+  // the table is hashed: print it in address order
+  std::vector<uint32_t> neighbors;
+  neighbors.reserve (m_neighbors.size ());
+  for (NeighborTable::const_iterator it = m_neighbors.begin (); it != m_neighbors.end (); it++)
+  {
+    neighbors.push_back (it->first);
+  }
+  std::sort (neighbors.begin (), neighbors.end ());
+
+  Time now = Simulator::Now ();
+  for (std::vector<uint32_t>::const_iterator neighbor = neighbors.begin (); neighbor != neighbors.end (); neighbor++)
+  {
+    const NeighborEntry &entry = m_neighbors.find (*neighbor)->second;
+    std::ostringstream address;
+    address << Ipv4Address (*neighbor);
+    *os << std::setiosflags (std::ios::left) << std::setw (17) << address.str ();
+    *os << std::setiosflags (std::ios::left) << std::setw (4) << entry.interface;
+    *os << std::setiosflags (std::ios::left) << std::setw (14) << (entry.responsive ? "ALIVE" : "UNRESPONSIVE");
+    *os << std::setiosflags (std::ios::left) << std::setw (12) << (entry.responsive ? (now - entry.upSince).GetSeconds () : 0);
+    *os << (now - entry.lastHeard).GetSeconds ();
+    *os << '\n';
+  }
+  *os << '\n';
+}
+
+bool
+PIORoutingProtocol::IsEmpty (void)
+{
+  return m_neighbors.empty ();
 }
 
 void 
@@ -683,7 +2684,27 @@ PIORoutingProtocol::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
   
+  for (RoutesI it = m_routing.begin (); it != m_routing.end (); it++)
+  {
+    FreeRoute (it->first);
+  }
   m_routing.clear ();
+  DeleteTables ();
+  m_interfaceTables.clear ();
+  // the pending timers refer to the records, they must not fire anymore
+  m_routeTimers.Clear ();
+  m_routeTimerEvent.Cancel ();
+  m_routeTrie.Clear ();
+  m_routesByGateway.clear ();
+  m_routesByInterface.clear ();
+  m_routesByPrefix.clear ();
+  m_compiledFib.Clear ();
+  m_compiledFibBuilt = false;
+  m_nextHops.Clear ();
+  m_routeCache.clear ();
+  m_deviceInterfaces.clear ();
+  m_flowlets.clear ();
+  m_localAddresses.clear ();
 
   for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++ )
   {
@@ -698,6 +2719,13 @@ PIORoutingProtocol::DoDispose ()
 
   m_nextKeepAliveMessage.Cancel ();
   m_nextKeepAliveMessage = EventId ();
+  m_neighborCheck.Cancel ();
+  m_neighborCheck = EventId ();
+  m_probeEvent.Cancel ();
+  m_probeEvent = EventId ();
+  m_neighbors.clear ();
+  m_keepAlives.clear ();
+  m_advertisements.clear ();
   
   m_nextTriggeredUpdate.Cancel ();
   m_nextTriggeredUpdate = EventId ();
@@ -705,10 +2733,51 @@ PIORoutingProtocol::DoDispose ()
   m_nextPeriodicUpdate.Cancel ();
   m_nextPeriodicUpdate = EventId ();
 
+  m_nextRouteRequest.Cancel ();
+  m_nextRouteRequest = EventId ();
+  m_changedPrefixes.clear ();
+
   m_ipv4 = 0;
 
 }
 
+/*
+*  PIORouteSpec
+*/
+
+PIORouteSpec::PIORouteSpec () : interface (0),
+                                metric (0),
+                                sequenceNo (0)
+{
+  /*cstrctr*/
+}
+
+PIORouteSpec::PIORouteSpec (Ipv4Address network, Ipv4Mask networkMask, uint32_t interface, uint16_t metric, uint16_t sequenceNo, Time timeoutTime, Time garbageCollectionTime)
+  : network (network),
+    networkMask (networkMask),
+    nextHop (Ipv4Address::GetZero ()),
+    interface (interface),
+    metric (metric),
+    sequenceNo (sequenceNo),
+    timeoutTime (timeoutTime),
+    garbageCollectionTime (garbageCollectionTime)
+{
+  /*cstrctr*/
+}
+
+PIORouteSpec::PIORouteSpec (Ipv4Address network, Ipv4Mask networkMask, Ipv4Address nextHop, uint32_t interface, uint16_t metric, uint16_t sequenceNo, Time timeoutTime, Time garbageCollectionTime)
+  : network (network),
+    networkMask (networkMask),
+    nextHop (nextHop),
+    interface (interface),
+    metric (metric),
+    sequenceNo (sequenceNo),
+    timeoutTime (timeoutTime),
+    garbageCollectionTime (garbageCollectionTime)
+{
+  /*cstrctr*/
+}
+
 /*
 *  PIORoutingEntry
 */
@@ -716,7 +2785,9 @@ PIORoutingProtocol::DoDispose ()
 PIORoutingEntry::PIORoutingEntry () : m_sequenceNo (0),
                                         m_metric (0),
                                         m_changed (false),
-                                        m_validity (INVALID)
+                                        m_validity (INVALID),
+                                        m_connected (false),
+                                        m_nextHop (PIONextHopTable::NONE)
 {
   /*cstrctr*/
 }
@@ -729,7 +2800,9 @@ PIORoutingEntry::PIORoutingEntry (Ipv4Address network,
 (network, networkMask, nextHop, interface)), m_sequenceNo (0),
                                              m_metric (0),
                                              m_changed (false),
-                                             m_validity (INVALID)
+                                             m_validity (INVALID),
+                                             m_connected (false),
+                                             m_nextHop (PIONextHopTable::NONE)
 {
   /*cstrctr*/
 }
@@ -741,7 +2814,9 @@ PIORoutingEntry::PIORoutingEntry (Ipv4Address network,
 (network, networkMask, interface)), m_sequenceNo (0),
                                     m_metric (0),
                                     m_changed (false),
-                                    m_validity (INVALID)
+                                    m_validity (INVALID),
+                                    m_connected (false),
+                                    m_nextHop (PIONextHopTable::NONE)
 {
   /*cstrctr*/
 }
@@ -752,7 +2827,9 @@ PIORoutingEntry::PIORoutingEntry (Ipv4Address host,
 (host, interface)), m_sequenceNo (0),
                     m_metric (0),
                     m_changed (false),
-                    m_validity (INVALID)
+                    m_validity (INVALID),
+                    m_connected (false),
+                    m_nextHop (PIONextHopTable::NONE)
 {
   /*cstrctr*/
 }
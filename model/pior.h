@@ -23,9 +23,13 @@
 
 #include <cassert>
 #include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <sys/types.h>
 
-//#include "ns3/pio-header.h"
+#include "ns3/pio-header.h"
 
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-interface.h"
@@ -39,6 +43,14 @@
 #include "ns3/timer.h"
 #include "ns3/net-device.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/traced-value.h"
+
+#include "ns3/pior-route-trie.h"
+#include "ns3/pior-compiled-fib.h"
+#include "ns3/pior-next-hop.h"
+#include "ns3/pior-route-arena.h"
+#include "ns3/pior-timer-wheel.h"
+#include "ns3/pior-snapshot.h"
 
 namespace ns3 {
 
@@ -49,6 +61,8 @@ namespace ns3 {
 
 #define PIO_PORT 272
 #define PIO_LISTEN_PORT 273
+#define PIO_ALL_NODE "224.0.0.9"
+#define PIO_INFINITY 16
 
 /**
  * Split Horizon strategy type.
@@ -68,6 +82,14 @@ enum PrintingOption {
   N_TABLE, //!< Print the neighbor table
 };
 
+/**
+ * Load balancing over equal-cost next hops.
+ */
+enum LoadBalancingType {
+  FLOW_HASH, //!< Every packet of a flow takes the next hop selected by its flow hash
+  FLOWLET,   //!< A flow may change next hop after an idle gap (flowlet switching)
+};
+
 /**
  * Set the validity of both route and neighbor records 
  */
@@ -90,6 +112,18 @@ enum UpdateType
 /**
   * \ingroup PIO
   * \brief PIO Routing Table Entry
+  *
+  * On LP64 targets an entry takes 48 bytes: 24 for Ipv4RoutingTableEntry and
+  * its virtual table pointer, 16 for the PIO fields and their padding, and 8
+  * for the shared Ipv4Route.
+  *
+  * On x86-64 with 100000 /24 routes, a route costs about 561 bytes: 224 for
+  * the entry, its routing table node and its three index nodes (304 from the
+  * global heap instead of the route arena), 241 for its trie nodes, route
+  * and member lists and timer, 64 per advertising interface, and 32 for its
+  * Ipv4Route once it forwards. The entry is kept whole rather than split
+  * into per-field arrays: it is under a tenth of that cost, and forwarding
+  * reads a single field of it, the Ipv4Route, after the FIB lookup.
  */
 class PIORoutingEntry : public Ipv4RoutingTableEntry
 {
@@ -192,11 +226,58 @@ public:
     m_validity = validity;
   }
 
+  /**
+  * \brief Get and Set whether the route is the connected route of an
+  * interface address, installed and withdrawn by the routing protocol
+  * \param connected true if the route is a connected route
+  * \returns true if the route is a connected route
+  */
+  bool GetConnected (void) const
+  {
+    return m_connected;
+  }
+  void SetConnected (bool connected)
+  {
+    m_connected = connected;
+  }
+
+  /**
+  * \brief Get and Set the shared next hop of the route (see PIONextHopTable)
+  * \param nextHop the next hop identifier
+  * \returns the next hop identifier
+  */
+  uint32_t GetNextHop (void) const
+  {
+    return m_nextHop;
+  }
+  void SetNextHop (uint32_t nextHop)
+  {
+    m_nextHop = nextHop;
+  }
+
+  /**
+  * \brief Get and Set the route handed out for the packets forwarded through
+  * this record, built on first use (see PIORoutingProtocol::GetIpv4Route)
+  * \param route the route, or 0 to have it built again
+  * \returns the route, or 0 if it is not built
+  */
+  Ptr<Ipv4Route> GetIpv4Route (void) const
+  {
+    return m_route;
+  }
+  void SetIpv4Route (Ptr<Ipv4Route> route)
+  {
+    m_route = route;
+  }
+
 private:
   uint16_t m_sequenceNo; //!< sequence number of the route record
   uint16_t m_metric; //!< route metric
   bool m_changed; //!< route has been updated
-  Validity m_validity; //!< validity of the routing record
+  uint8_t m_validity; //!< validity of the routing record, stored as a byte to keep the entry compact
+  bool m_connected; //!< connected route of an interface address
+  uint32_t m_nextHop; //!< shared next hop, NONE while the route is not in the table
+  Ptr<Ipv4Route> m_route; //!< immutable route shared by the packets forwarded through this record
 }; // PIO Routing Table Entry
 
 /**
@@ -208,6 +289,49 @@ private:
  */
 std::ostream& operator<< (std::ostream& os, PIORoutingEntry const& route);
 
+/**
+ * \ingroup PIO
+ * \brief Specification of a route installed with PIORoutingProtocol::AddRoutes.
+ */
+struct PIORouteSpec
+{
+  PIORouteSpec (void);
+
+  /**
+   * \brief Route to a directly connected network (or host, with a /32 mask).
+   * \param network network address
+   * \param networkMask network mask
+   * \param interface interface index
+   * \param metric the cumulative hop count to the destination network
+   * \param sequenceNo sequence number of the route
+   * \param timeoutTime time after which the route expires
+   * \param garbageCollectionTime time after which an expired route is removed
+   */
+  PIORouteSpec (Ipv4Address network, Ipv4Mask networkMask, uint32_t interface, uint16_t metric, uint16_t sequenceNo, Time timeoutTime, Time garbageCollectionTime);
+
+  /**
+   * \brief Route to a network through a next hop.
+   * \param network network address
+   * \param networkMask network mask
+   * \param nextHop next hop address
+   * \param interface interface index
+   * \param metric the cumulative hop count to the destination network
+   * \param sequenceNo sequence number of the route
+   * \param timeoutTime time after which the route expires
+   * \param garbageCollectionTime time after which an expired route is removed
+   */
+  PIORouteSpec (Ipv4Address network, Ipv4Mask networkMask, Ipv4Address nextHop, uint32_t interface, uint16_t metric, uint16_t sequenceNo, Time timeoutTime, Time garbageCollectionTime);
+
+  Ipv4Address network; //!< network address
+  Ipv4Mask networkMask; //!< network mask
+  Ipv4Address nextHop; //!< next hop, 0.0.0.0 for a directly connected network
+  uint32_t interface; //!< interface index
+  uint16_t metric; //!< the cumulative hop count to the destination network
+  uint16_t sequenceNo; //!< sequence number of the route
+  Time timeoutTime; //!< time after which the route expires
+  Time garbageCollectionTime; //!< time after which an expired route is removed
+};
+
 /**
  * \ingroup PIO
  *
@@ -245,11 +369,49 @@ public:
   /**
   * \brief look up for a forwarding route in the routing table.
   *
+  * The routes of the longest matching prefix having the lowest metric are
+  * equal-cost next hops; the flow hash selects one of them, so that every
+  * packet of a flow takes the same path.
+  * When the best next hops have failed, the next best ones are used only if
+  * they are loop-free alternates (see PIONextHopTable::IsLoopFree).
+  *
   * \param address destination address
   * \param dev output net-device if any (assigned 0 otherwise)
+  * \param flowHash hash of the flow of the packet (see FlowHash)
+  * \param table routing table to search, 0 for the main table (see AddTable)
   * \return Ipv4Route where that the given packet has to be forwarded 
   */
-  Ptr<Ipv4Route> LookupRoute (Ipv4Address address, Ptr<NetDevice> dev = 0);
+  Ptr<Ipv4Route> LookupRoute (Ipv4Address address, Ptr<NetDevice> dev = 0, uint32_t flowHash = 0, uint32_t table = 0);
+
+  /**
+  * \brief Hash the flow of a packet for equal-cost multipath selection.
+  *
+  * The hash covers the source and destination addresses and the protocol,
+  * plus the ports of unfragmented TCP and UDP packets when the transport
+  * header is at the start of the packet. It is salted with the node id so
+  * that successive routers do not all make the same choice.
+  *
+  * \param header IPv4 header of the packet
+  * \param p the packet, may be 0
+  * \param transport true if the packet starts with its transport header
+  * \return the flow hash
+  */
+  uint32_t FlowHash (const Ipv4Header &header, Ptr<const Packet> p, bool transport) const;
+
+  /**
+   * \brief Mark a gateway as reachable or not.
+   *
+   * Every prefix using the gateway immediately moves to its other next hops,
+   * in a time independent of the number of routes through the gateway. The
+   * routes are left as they are, but the prefixes whose advertisement moved
+   * with their next hops go out with the next triggered update. A gateway is
+   * marked reachable again when a route through it is installed.
+   *
+   * \param gateway neighbor address
+   * \param up true if the gateway is reachable
+   * \return true if the state of the gateway changed
+   */
+  bool SetGatewayState (Ipv4Address gateway, bool up);
 
   /**
    * \brief Add a default route to the router.
@@ -299,6 +461,113 @@ public:
    */
   void AddHostRouteTo (Ipv4Address host, uint32_t interface, uint16_t metric, uint16_t sequenceNo, Time timeoutTime, Time garbageCollectionTime);
 
+  /**
+   * \brief Install a batch of routes.
+   *
+   * Each route is added to the routing table like a route given to
+   * AddNetworkRouteTo, with these differences:
+   * - a route expires after its timeout time (plus the usual random delay)
+   *   unless it is the default route or both its timeout and garbage
+   *   collection times are zero, whether it has a next hop or not.
+   *   AddNetworkRouteTo and AddHostRouteTo arm the timer of a route with a
+   *   next hop, or of a host route, even when both times are zero, and
+   *   AddNetworkRouteTo arms it for a default route without next hop;
+   * - a route whose network, mask, next hop and interface match a route of
+   *   the table or an earlier route of the batch is rejected instead of being
+   *   added a second time;
+   * - 127.0.0.1/32 without next hop is the local host route, as with
+   *   AddHostRouteTo.
+   *
+   * The order of the batch does not matter: the routes of a prefix are
+   * forwarded along their best paths, the lowest metric first, then the most
+   * recent sequence number. The FIB and the triggered update are updated
+   * once per prefix of the batch, the compiled forwarding table and the
+   * route timer event once for the whole batch.
+   *
+   * \param routes the routes
+   * \return the number of routes installed
+   */
+  uint32_t AddRoutes (const std::vector<PIORouteSpec> &routes);
+
+  /**
+   * \brief Install the routes of a snapshot.
+   *
+   * The records are installed as by AddRoutes, straight from the given
+   * memory (typically a mapped snapshot file). Routes not flagged PERMANENT
+   * expire after RouteTimeoutDelay. The node field is not checked.
+   *
+   * \param records the records
+   * \param nRecords the number of records
+   * \return the number of routes installed
+   */
+  uint32_t LoadRoutes (const PIOSnapshotRecord *records, uint32_t nRecords);
+
+  /**
+   * \brief Add a routing table (VRF), isolated from the main table and from
+   * the other tables.
+   *
+   * The main table, 0, holds the routes exchanged by PIO. The other tables
+   * hold static routes installed with AddRoutes (table, routes), and are
+   * searched by the packets received on the interfaces bound to them (see
+   * SetInterfaceTable) and by the packets sent out of those interfaces.
+   * Overlapping prefixes may be installed in different tables.
+   *
+   * \return the identifier of the new table
+   */
+  uint32_t AddTable (void);
+
+  /**
+   * \return the number of routing tables, including the main table
+   */
+  uint32_t GetNTables (void) const;
+
+  /**
+   * \brief Bind an interface to a routing table.
+   * \param interface interface index
+   * \param table the table, 0 for the main table
+   */
+  void SetInterfaceTable (uint32_t interface, uint32_t table);
+
+  /**
+   * \param interface interface index
+   * \return the routing table the interface is bound to
+   */
+  uint32_t GetInterfaceTable (uint32_t interface) const;
+
+  /**
+   * \brief Install a batch of routes in a routing table.
+   *
+   * The routes of the main table are installed as described in
+   * AddRoutes (routes). The routes of the other tables go through the same
+   * duplicate check and the same per-prefix FIB update, but are static:
+   * their timeout and garbage collection times are ignored and they are not
+   * advertised.
+   *
+   * \param table the table
+   * \param routes the routes
+   * \return the number of routes installed
+   */
+  uint32_t AddRoutes (uint32_t table, const std::vector<PIORouteSpec> &routes);
+
+  /**
+   * \brief Append the valid and local host routes to a snapshot, oldest first.
+   * \param node id written in the node field of the records
+   * \param records the records to append to
+   */
+  void SaveRoutes (uint32_t node, std::vector<PIOSnapshotRecord> &records) const;
+
+  /**
+   * \brief Get the set of interface excluded from the protocol
+   * \return set of excluded interfaces
+   */
+  std::set<uint32_t> GetInterfaceExclusions () const;
+
+  /**
+   * \brief Set the set of interface excluded from the protocol
+   * \param exceptions set of excluded interfaces
+   */
+  void SetInterfaceExclusions (std::set<uint32_t> exceptions);
+
 protected:
   /**
    * \brief Dispose this object.
@@ -313,29 +582,181 @@ private:
 
   // \name for route management
   // \{
-  /// Container for a Route table entry 
-  typedef std::pair <PIORoutingEntry*, EventId> RouteTableRecord;
+  /// Container for a Route table entry, with the identifier of its route timer
+  typedef std::pair <PIORoutingEntry*, uint32_t> RouteTableRecord;
   
+  /// Allocator of the routing table records, drawing from the route arena
+  typedef PIOArenaAllocator<RouteTableRecord> RouteAllocator;
+
   /// Container for an instance of the neighbor table
-  typedef std::list<std::pair <PIORoutingEntry*, EventId> > RoutingTableInstance;
+  typedef std::list<RouteTableRecord, RouteAllocator> RoutingTableInstance;
 
   /// Iterator for the Neighbor table entry container
-  typedef std::list<std::pair <PIORoutingEntry*, EventId> >::iterator RoutesI;
+  typedef RoutingTableInstance::iterator RoutesI;
 
   /// Constant Iterator for the Neighbor table entry container
-  typedef std::list<std::pair <PIORoutingEntry*, EventId> >::const_iterator RoutesCI;
+  typedef RoutingTableInstance::const_iterator RoutesCI;
+
+  /// Timer wheel of the route timeout and garbage collection timers
+  typedef PIOTimerWheel<RoutesI> RouteTimerWheel;
+
+  /// Index from the gateway address to the routing table records
+  typedef std::multimap<Ipv4Address, RoutesI, std::less<Ipv4Address>, PIOArenaAllocator<std::pair<const Ipv4Address, RoutesI> > > GatewayIndex;
+
+  /// Index from the interface index to the routing table records
+  typedef std::multimap<uint32_t, RoutesI, std::less<uint32_t>, PIOArenaAllocator<std::pair<const uint32_t, RoutesI> > > InterfaceIndex;
+
+  /// Index from the (network, mask) prefix to the routing table records
+  typedef std::multimap<uint64_t, RoutesI, std::less<uint64_t>, PIOArenaAllocator<std::pair<const uint64_t, RoutesI> > > PrefixIndex;
 
   /**
-   * \brief Invalidate a route.
-   * \param route the route to be removed
+   * \param network network address
+   * \param mask network mask
+   * \return the key of the prefix in the prefix index
    */
-  void InvalidateRoute (PIORoutingEntry *route);
+  static uint64_t PrefixKey (Ipv4Address network, Ipv4Mask mask)
+  {
+    return (uint64_t (network.Get ()) << 32) | mask.Get ();
+  }
+
+  /**
+   * \brief Allocate a route entry in the route arena.
+   * \return storage for one PIORoutingEntry
+   */
+  void* AllocateRoute (void)
+  {
+    return m_routeArena.Allocate (sizeof (PIORoutingEntry));
+  }
 
   /**
-   * \brief Delete a route.
-   * \param route the route to be removed
+   * \brief Destroy a route entry allocated with AllocateRoute.
+   * \param route the route
    */
-  void DeleteRoute (PIORoutingEntry *route);
+  void FreeRoute (PIORoutingEntry *route);
+
+  /**
+   * \brief Destroy the routing tables other than the main table and their
+   * routes. Called from DoDispose, and from the destructor of a protocol
+   * which was never disposed.
+   */
+  void DeleteTables (void);
+
+  /**
+   * \param interface interface index
+   * \return true if the interface is up, or is not known yet (no Ipv4 bound,
+   * or an interface not added yet)
+   */
+  bool IsInterfaceUp (uint32_t interface) const;
+
+  /**
+   * \brief Add a routing table record to the secondary indexes.
+   * \param it the record
+   */
+  void IndexRoute (RoutesI it);
+
+  /**
+   * \brief Remove a routing table record from the secondary indexes.
+   * \param it the record
+   */
+  void UnindexRoute (RoutesI it);
+
+  /**
+   * \brief Arm the timer of a record, replacing the one already armed.
+   *
+   * The timer of a VALID record invalidates it, the timer of an INVALID
+   * record deletes it. The expiry is rounded up to the next wheel tick.
+   *
+   * \param it the record
+   * \param delay delay before the timer expires
+   */
+  void ScheduleRouteTimer (RoutesI it, Time delay);
+
+  /**
+   * \brief Install one route of a batch in a routing table.
+   *
+   * In the main table, the route is indexed and its timer is armed in the
+   * wheel. In the other tables, the route is static. The FIB, the triggered
+   * update, the wheel event and the compiled forwarding table are left to
+   * EndInstallRoutes.
+   *
+   * \param table the table
+   * \param spec the route
+   * \return false if the route is a duplicate
+   */
+  bool InstallRoute (uint32_t table, const PIORouteSpec &spec);
+
+  /**
+   * \brief Update the FIB of every prefix given a route by the batch. In the
+   * main table, also record the change of those prefixes and update the
+   * compiled forwarding table and the wheel event.
+   * \param table the table
+   * \param added number of routes installed by the batch
+   */
+  void EndInstallRoutes (uint32_t table, uint32_t added);
+
+  /**
+   * \param delay delay from now
+   * \return the route timer wheel tick at which a timer armed with the delay expires
+   */
+  uint64_t GetRouteTimerTick (Time delay) const;
+
+  /**
+   * \param table the table
+   * \param network network address
+   * \param mask network mask
+   * \param nextHop next hop, 0.0.0.0 for a directly connected network
+   * \param interface interface index
+   * \return true if the routing table holds a route with these parameters
+   */
+  bool HasRoute (uint32_t table, Ipv4Address network, Ipv4Mask mask, Ipv4Address nextHop, uint32_t interface) const;
+
+  /**
+   * \brief Disarm the timer of a record, if any.
+   * \param it the record
+   */
+  void CancelRouteTimer (RoutesI it);
+
+  /**
+   * \param it the record
+   * \return the time left before the timer of the record expires, or zero
+   */
+  Time GetRouteTimerLeft (RoutesCI it) const;
+
+  /**
+   * \brief Move the route timer wheel to the current tick, so that timers
+   * are placed relative to the current time. Timers expiring meanwhile
+   * become due and are processed by the next RouteTimerTick.
+   */
+  void AdvanceRouteTimers (void);
+
+  /**
+   * \brief Schedule the simulator event of the next tick of the route timer
+   * wheel that has work, if it is not already scheduled.
+   */
+  void ArmRouteTimerEvent (void);
+
+  /**
+   * \brief Advance the route timer wheel and process every expired timer.
+   */
+  void RouteTimerTick (void);
+
+  /**
+   * \brief Invalidate a VALID routing table record and schedule its deletion.
+   * \param it the record
+   */
+  void InvalidateRecord (RoutesI it);
+
+  /**
+   * \brief Invalidate a route. Called by the route timeout event.
+   * \param it the routing table record of the route
+   */
+  void InvalidateRoute (RoutesI it);
+
+  /**
+   * \brief Delete a route. Called by the garbage collection event.
+   * \param it the routing table record of the route
+   */
+  void DeleteRoute (RoutesI it);
 
   /**
    * \brief Invalidate routes for a given interface.
@@ -344,6 +765,19 @@ private:
    */  
   bool InvalidateRoutesForInterface (uint32_t interface);
 
+  /**
+   * \brief Invalidate the routes through a down interface whose prefix has no
+   * loop-free alternate left.
+   *
+   * The prefixes having an alternate already forward through it (see
+   * PIONextHopTable); their routes through the interface are kept, so that
+   * they are used again as soon as the interface comes back up.
+   *
+   * \param interface the interface
+   * \return true if found a route
+   */
+  bool InvalidateRoutesWithoutAlternate (uint32_t interface);
+
   /**
    * \brief Invalidate broken routes.
    * broken routes are separated using the sequence number. All ODD valued sequence numbers indicate that the route is
@@ -379,8 +813,475 @@ private:
    */
   bool FindRouteRecord (Ipv4Address address, Ipv4Mask mask, RoutesI &foundRoute);
 
+  /**
+   * \brief Propagate a change of the routes of a prefix to the forwarding
+   * state: the best paths of the prefix are selected again and written into
+   * the FIB, the route cache is flushed and the compiled forwarding table
+   * is updated if it is built.
+   * \param network network address
+   * \param mask network mask
+   * \param table the routing table of the prefix
+   */
+  void UpdateForwarding (Ipv4Address network, Ipv4Mask mask, uint32_t table = 0);
+
+  /**
+   * \brief Build the compiled forwarding table from the FIB.
+   */
+  void CompileForwarding (void);
+
+  /**
+   * \brief Select the next hops of a prefix among its VALID routes.
+   *
+   * The best paths have the lowest metric and, among those, the most recent
+   * sequence number; a route of the lowest metric with an older sequence
+   * number is left out. The routes of higher metric are kept as backups.
+   *
+   * \param routes the routes of the prefix
+   * \param members filled with the next hops and their metric, in canonical order
+   * \param paths filled with the route of each member, in member order
+   */
+  static void GetGroupMembers (const PIORouteTrie::RouteList &routes, std::vector<PIONextHopTable::Member> &members,
+                               std::vector<PIORoutingEntry*> &paths);
+
+  /**
+   * \brief Get the interface of a device, without scanning the interfaces
+   * once the device is known.
+   * \param device the device
+   * \return the interface index, or -1 if the device is not one of the node
+   */
+  int32_t GetInterfaceForDevice (Ptr<NetDevice> device);
+
+  /**
+   * \brief Get the route handed out for the packets forwarded through a
+   * record, building it on first use.
+   *
+   * The route only depends on the record and on the addresses of its
+   * interface, so it is shared by every packet until one of them changes.
+   *
+   * \param route the record
+   * \return the route
+   */
+  Ptr<Ipv4Route> GetIpv4Route (PIORoutingEntry *route);
+
+  /**
+   * \brief Drop the routes built for the records of an interface, after its
+   * addresses changed.
+   * \param interface interface index
+   */
+  void ResetIpv4Routes (uint32_t interface);
+
+  /**
+   * \brief Install the next-hop group of a prefix in the FIB, and in the
+   * compiled forwarding table if it is built, or withdraw the prefix if it
+   * has no next hop.
+   * \param network network address
+   * \param length prefix length
+   * \param members next hops of the prefix
+   * \param paths route of each member, in member order
+   * \param table the routing table of the prefix; only the main table is compiled
+   */
+  void SetForwardingGroup (Ipv4Address network, uint8_t length, const std::vector<PIONextHopTable::Member> &members,
+                           const std::vector<PIORoutingEntry*> &paths, uint32_t table);
+
+  /**
+   * \brief Invalidate every route cache entry by moving to a new routing
+   * table generation.
+   */
+  void FlushRouteCache (void);
+
+  /**
+   * \brief Get the next hop selector of a forwarded packet in flowlet mode.
+   *
+   * A flow keeps its selector while its packets are closer than the flowlet
+   * timeout; after a longer gap, a new flowlet starts with a random selector
+   * and may take another equal-cost next hop.
+   *
+   * \param flowHash hash of the flow of the packet
+   * \return the selector to give to LookupRoute as flow hash
+   */
+  uint32_t GetFlowletHash (uint32_t flowHash);
+
+  /**
+   * \brief Open the socket sending the updates on an interface, unless the
+   * interface is excluded or already has one.
+   * \param interface interface index
+   */
+  void OpenInterfaceSocket (uint32_t interface);
+
+  /**
+   * \brief Close the socket sending the updates on an interface, if any.
+   * \param interface interface index
+   */
+  void CloseInterfaceSocket (uint32_t interface);
+
+  /**
+   * \param interface interface index
+   * \return the socket sending the updates on the interface, or 0
+   */
+  Ptr<Socket> GetInterfaceSocket (uint32_t interface) const;
+
+  /**
+   * \brief Receive and process a PIO message.
+   * \param socket the socket the message was received on
+   */
+  void Receive (Ptr<Socket> socket);
+
+  /**
+   * \brief Process a PIO message: refresh its sender in the neighbor table,
+   * then handle the request or response.
+   * \param hdr the message
+   * \param sender the sender address
+   * \param senderPort the sender port
+   * \param interface the interface the message was received on
+   */
+  void HandleMessage (const PIOHeader &hdr, Ipv4Address sender, uint16_t senderPort, uint32_t interface);
+
+  /**
+   * \brief Answer a request for routes.
+   *
+   * A request for the whole table (a single entry for 0.0.0.0/0 with an
+   * infinite metric) is answered as a periodic update; otherwise the metric
+   * of every requested prefix is returned.
+   *
+   * \param hdr the request
+   * \param sender the sender address
+   * \param senderPort the sender port
+   * \param interface the interface the request was received on
+   */
+  void HandleRequests (const PIOHeader &hdr, Ipv4Address sender, uint16_t senderPort, uint32_t interface);
+
+  /**
+   * \brief Install, refresh or withdraw the routes advertised by a neighbor.
+   *
+   * The routes learned from a neighbor are kept per (prefix, neighbor), so
+   * that the other neighbors remain available as equal-cost next hops or
+   * alternates. An entry with an infinite metric or an odd sequence number
+   * withdraws the route. Only actual changes are recorded for the triggered
+   * updates.
+   *
+   * \param hdr the response
+   * \param sender the neighbor address
+   * \param interface the interface the response was received on
+   */
+  void HandleResponses (const PIOHeader &hdr, Ipv4Address sender, uint32_t interface);
+
+  /**
+   * \brief Ask the neighbors for their whole table, on every interface.
+   */
+  void SendRouteRequest (void);
+
+  /**
+   * \brief Send the periodic update on every interface and schedule the next one.
+   *
+   * The periodic update carries every prefix, so it also carries the pending
+   * changes: the triggered update is cancelled.
+   */
+  void SendPeriodicUpdate (void);
+
+  /**
+   * \brief Send the changed prefixes on every interface and clear the change set.
+   */
+  void SendTriggeredUpdate (void);
+
+  /**
+   * \brief Send the advertisements of the prefixes on an interface, as held
+   * in its advertisement view.
+   * \param socket the socket of the interface
+   * \param interface the interface index
+   * \param destination destination address
+   * \param port destination port
+   * \param type PERIODIC for every prefix, TRIGGERED for the changed ones
+   */
+  void SendUpdate (Ptr<Socket> socket, uint32_t interface, Ipv4Address destination, uint16_t port, UpdateType type);
+
+  /**
+   * \brief Send a PIO message.
+   * \param socket the socket
+   * \param hdr the message
+   * \param destination destination address
+   * \param port destination port
+   */
+  void SendMessage (Ptr<Socket> socket, const PIOHeader &hdr, Ipv4Address destination, uint16_t port);
+
+  /**
+   * \brief Get the advertisement of a prefix on an interface.
+   *
+   * The best route among the active members of the FIB group of the prefix
+   * is advertised, subject to the split horizon strategy, so that the
+   * advertisement follows the next hops the packets are forwarded to. A
+   * prefix whose VALID routes all have unusable next hops is advertised with
+   * an infinite metric, and a prefix left with INVALID routes only with an
+   * infinite metric and an odd sequence number, until its routes are deleted.
+   *
+   * \param prefix the prefix, see PrefixKey
+   * \param interface the interface index
+   * \param rte filled with the advertisement
+   * \return false if the prefix is not advertised on the interface
+   */
+  bool GetAdvertisement (uint64_t prefix, uint32_t interface, PIORte &rte) const;
+
+  /**
+   * \brief Recompute the advertisement of a prefix in every advertisement view.
+   * \param prefix the prefix, see PrefixKey
+   * \return true if the advertisement changed in a view
+   */
+  bool UpdateAdvertisements (uint64_t prefix);
+
+  /**
+   * \brief Build the advertisement view of an interface from the whole table.
+   * \param interface interface index
+   */
+  void BuildAdvertisementView (uint32_t interface);
+
+  /**
+   * \brief Update the advertisement views for a changed prefix, add it to
+   * the change set and schedule a triggered update, if none is pending.
+   * Changes are only recorded once the protocol runs.
+   * \param network network address
+   * \param mask network mask
+   */
+  void RecordChange (Ipv4Address network, Ipv4Mask mask);
+
+  /**
+   * \brief Record the change of a prefix routed through a next hop which
+   * changed state, if its advertisement changed with the active next hops
+   * of its FIB group.
+   * \param route a route of the prefix
+   */
+  void RecordNextHopChange (const PIORoutingEntry *route);
+
+  /**
+   * \brief Record the change of the prefixes routed through an interface
+   * which changed state, see RecordNextHopChange.
+   * \param interface interface index
+   */
+  void RecordInterfaceChange (uint32_t interface);
 
+  /**
+   * \brief Add a prefix to the change set and schedule a triggered update,
+   * if none is pending.
+   * \param prefix the prefix, see PrefixKey
+   */
+  void ScheduleTriggeredUpdate (uint64_t prefix);
+
+  /**
+   * \brief Record that a neighbor was heard from.
+   *
+   * A new neighbor, or an unresponsive one coming back, is a change of the
+   * neighborhood of the interface: see NeighborChanged. Such a neighbor,
+   * when heard through a keep-alive, is asked for its whole table, as the
+   * routes through it may have been invalidated.
+   *
+   * \param neighbor the neighbor address
+   * \param interface the interface the neighbor was heard on
+   * \param command command of the message heard
+   */
+  void RefreshNeighbor (Ipv4Address neighbor, uint32_t interface, PIOHeader::Command_e command);
+
+  /**
+   * \brief Expire the neighbors not heard from for NeighborTimeoutDelay,
+   * invalidating the routes through them, and delete those unresponsive for
+   * GarbageCollection more.
+   *
+   * A single event serves the whole neighbor table: hearing from a neighbor
+   * only updates its entry, and the event is rescheduled at the earliest
+   * expiry once it fires.
+   */
+  void CheckNeighbors (void);
+
+  /**
+   * \brief Send the fast failure detection probes and check every session.
+   *
+   * A session is up with every neighbor whose probes are heard. Every
+   * ProbeInterval, one probe is sent on every interface, and the neighbors
+   * whose last probe is older than DetectMultiplier intervals are declared
+   * unresponsive at once: the routes through them are invalidated. This
+   * single event drives all the sessions of the node, whatever their number.
+   */
+  void ProbeTick (void);
+
+  /**
+   * \brief Reset the keep-alive interval of an interface to the minimum after
+   * a neighbor appeared or was lost on it.
+   * \param interface interface index
+   */
+  void NeighborChanged (uint32_t interface);
+
+  /**
+   * \brief Send a keep-alive on every interface that sent no message for its
+   * keep-alive interval, then back the intervals off.
+   *
+   * Any message sent to all the neighbors of an interface, such as a routing
+   * update, counts as a keep-alive: keep-alives are only sent on quiet
+   * interfaces. The interval of an interface doubles with every keep-alive
+   * sent, from MinKeepAliveInterval after a change of its neighborhood up to
+   * KeepAliveInterval once it is stable.
+   */
+  void SendKeepAlives (void);
+
+  /**
+   * \brief Schedule the keep-alive event at the earliest keep-alive due.
+   */
+  void ScheduleKeepAlive (void);
+
+  /**
+   * \brief Print the neighbor table.
+   * \param stream the output stream
+   */
+  void PrintNeighborTable (Ptr<OutputStreamWrapper> stream) const;
+
+  /**
+   * \param network network address
+   * \param mask network mask
+   * \param gateway gateway address
+   * \param interface interface index
+   * \param found the record of the route, if any
+   * \return true if the routing table holds a route with these parameters
+   */
+  bool FindRoute (Ipv4Address network, Ipv4Mask mask, Ipv4Address gateway, uint32_t interface, RoutesI &found);
+
+  /**
+   * \brief Add the addresses of an interface to the local address set.
+   * \param interface interface index
+   */
+  void AddLocalAddresses (uint32_t interface);
+
+  /**
+   * \brief Install the connected route of an address of an interface.
+   *
+   * Only the global addresses have a connected route. A connected route
+   * withdrawn but not yet deleted is made VALID again, with a new sequence
+   * number. An invalid route to the same network without gateway is taken
+   * over the same way; a VALID one added by the user is left as is.
+   * Connected routes are flagged (see PIORoutingEntry::GetConnected) so that
+   * only those are withdrawn by RemoveConnectedRoute and RemoveConnectedRoutes.
+   *
+   * \param interface interface index
+   * \param address the address
+   */
+  void AddConnectedRoute (uint32_t interface, Ipv4InterfaceAddress address);
+
+  /**
+   * \brief Withdraw the connected route of an address removed from an
+   * interface, unless another address of the interface is on the same network.
+   * \param interface interface index
+   * \param address the address
+   */
+  void RemoveConnectedRoute (uint32_t interface, Ipv4InterfaceAddress address);
+
+  /**
+   * \brief Withdraw every connected route of an interface going down. The
+   * routes without gateway added by the user are kept.
+   * \param interface interface index
+   */
+  void RemoveConnectedRoutes (uint32_t interface);
+
+  /**
+   * \brief Rebuild the local address set from the addresses of every interface.
+   */
+  void RebuildLocalAddresses (void);
+
+  /// Flowlet table entry
+  struct FlowletEntry
+  {
+    uint32_t flowHash; //!< hash of the flow using the entry
+    uint32_t selector; //!< next hop selector of the current flowlet
+    int64_t lastSeen; //!< time of the last packet of the flow, in time steps
+  };
+
+  /// Neighbor table entry
+  struct NeighborEntry
+  {
+    uint32_t interface; //!< interface the neighbor is heard on
+    bool responsive; //!< false once not heard from for the neighbor timeout
+    Time lastHeard; //!< time the neighbor was last heard from
+    Time upSince; //!< time the neighbor became responsive
+    Time lastProbe; //!< time of the last probe of the neighbor, zero if no fast detection session is up
+  };
+
+  /// Keep-alive state of an interface
+  struct KeepAliveState
+  {
+    Time lastSent; //!< time of the last message sent to all the neighbors
+    Time interval; //!< current keep-alive interval
+  };
+
+  /// Advertisement view of an interface: the advertised prefixes, by prefix key
+  typedef std::map<uint64_t, PIORte> AdvertisementView;
+
+  /// Advertisement views, by interface index
+  typedef std::map<uint32_t, AdvertisementView> AdvertisementViews;
+
+  /// Neighbor table, by neighbor address
+  typedef std::unordered_map<uint32_t, NeighborEntry> NeighborTable;
+
+  /// Keep-alive states, by interface index
+  typedef std::map<uint32_t, KeepAliveState> KeepAliveStates;
+
+  /// Device to interface index map
+  typedef std::map<Ptr<NetDevice>, int32_t> DeviceInterfaceMap;
+
+  /// Routing table other than the main table
+  struct VrfTable
+  {
+    /**
+     * \param arena the arena the trie nodes are allocated from
+     */
+    explicit VrfTable (PIORouteArena *arena) : fib (arena)
+    {
+    }
+
+    PIORouteTrie fib; //!< routes of the table and their selected groups
+    std::vector<PIORoutingEntry*> routes; //!< records of the table
+  };
+
+  /// Route cache entry
+  struct RouteCacheEntry
+  {
+    Ipv4Address destination; //!< destination address
+    uint32_t flowHash; //!< flow hash the route was resolved for
+    int32_t interface; //!< output interface the route was constrained to, -1 if none
+    uint32_t table; //!< routing table the route was resolved in
+    uint32_t generation; //!< routing table generation the route was resolved in
+    Ptr<Ipv4Route> route; //!< resolved route
+  };
+
+
+  PIORouteArena m_routeArena; //!< storage of the route entries, of the routing table and index nodes and of the trie nodes
   RoutingTableInstance m_routing;
+  GatewayIndex m_routesByGateway; //!< records of m_routing by gateway
+  InterfaceIndex m_routesByInterface; //!< records of m_routing by interface
+  PrefixIndex m_routesByPrefix; //!< records of m_routing by (network, mask)
+  PIORouteTrie m_routeTrie; //!< RIB and FIB: longest-prefix-match index of m_routing and the selected groups
+  std::vector<VrfTable*> m_vrfs; //!< routing tables 1 and above, the main table being m_routing, owned and freed by DeleteTables
+  std::vector<uint32_t> m_interfaceTables; //!< routing table of each interface, 0 beyond the end
+  RouteTimerWheel m_routeTimers; //!< route timeout and garbage collection timers
+  EventId m_routeTimerEvent; //!< simulator event of the next route timer wheel tick
+  uint64_t m_routeTimerEventTick; //!< tick of m_routeTimerEvent
+  Time m_routeTimerResolution; //!< duration of a route timer wheel tick
+  bool m_compiledFibEnabled; //!< use the compiled forwarding table for lookups
+  bool m_compiledFibBuilt; //!< the compiled forwarding table reflects the FIB
+  std::vector<uint64_t> m_installedPrefixes; //!< prefixes given a route by the current batch, see PrefixKey
+  std::vector<PIONextHopTable::Member> m_groupMembers; //!< next hops of the prefix being updated, reused by UpdateForwarding
+  std::vector<PIORoutingEntry*> m_groupPaths; //!< routes of m_groupMembers, reused by UpdateForwarding
+  PIOCompiledFib m_compiledFib; //!< DIR-24-8 compiled forwarding table
+  PIONextHopTable m_nextHops; //!< next hops of the routes and next-hop groups of the compiled prefixes
+  /// Local address set type, maps a local address to its interface index
+  typedef std::unordered_map<uint32_t, uint32_t> LocalAddressMap;
+  LocalAddressMap m_localAddresses; //!< addresses of every interface of the node
+
+  std::vector<RouteCacheEntry> m_routeCache; //!< direct-mapped destination to route cache
+  DeviceInterfaceMap m_deviceInterfaces; //!< interface index of the devices already resolved
+  uint32_t m_routeCacheSize; //!< number of route cache entries, 0 disables the cache
+  uint32_t m_routeGeneration; //!< routing table generation, bumped on every change
+  uint32_t m_flowHashSeed; //!< per-node salt of the flow hash
+  LoadBalancingType m_loadBalancing; //!< load balancing over equal-cost next hops
+  Time m_flowletTimeout; //!< idle gap after which a flow may change next hop
+  uint32_t m_flowletTableSize; //!< number of flowlet table entries
+  std::vector<FlowletEntry> m_flowlets; //!< direct-mapped flow to flowlet table
+  TracedValue<uint32_t> m_flowletsStarted; //!< number of flowlets started
+  TracedValue<uint32_t> m_routeCacheHits; //!< number of lookups served by the route cache
+  TracedValue<uint32_t> m_routeCacheMisses; //!< number of lookups that missed the route cache
   Ptr<Ipv4> m_ipv4; //!< IPv4 reference  
   bool m_initialized; //!< flag that indicates the protocol is already initialized.
   Ptr<UniformRandomVariable> m_rng; //!< Rng stream.
@@ -393,6 +1294,19 @@ private:
   
   EventId m_nextPeriodicUpdate; //!< Next periodic update event
   EventId m_nextTriggeredUpdate; //!< Next triggered update event
+  EventId m_nextRouteRequest; //!< route request sent at start-up
+
+  std::set<uint64_t> m_changedPrefixes; //!< prefixes changed since the last update, see PrefixKey
+  /**
+   * Advertisement views of the interfaces with a socket, i.e., of the
+   * interfaces that are up and not excluded. A view holds what is advertised
+   * on its interface, split horizon applied, and is updated with every
+   * change of a prefix, so that an update is only serialized from it. The
+   * views follow the split horizon strategy in effect when they are built.
+   */
+  AdvertisementViews m_advertisements;
+  PIOHeader m_receivedHeader; //!< last received message, reused to keep its entries allocated
+  PIOHeader m_sentHeader; //!< message being built by SendUpdate, reused likewise
 
   Time m_startupDelay; //!< Random delay before protocol start-up.  
   Time m_minTriggeredCooldownDelay; //!< minimum cool-down delay between two triggered updates
@@ -423,10 +1337,18 @@ private:
   bool IsEmpty(void);
 
   Time m_kamTimer; //!< time between two keep alive messages 
+  Time m_minKamTimer; //!< time between two keep alive messages after a change of the neighbors
   Time m_neighborTimeoutDelay; //!< Delay that determines the neighbor is UNRESPONSIVE
   Time m_garbageCollectionDelay; //!< Delay before remove UNRESPONSIVE route/neighbor record
   
   EventId m_nextKeepAliveMessage; //!< next Keep Alive Message event
+  EventId m_neighborCheck; //!< next neighbor expiry event
+  bool m_fastDetection; //!< send fast failure detection probes and act on their loss
+  Time m_probeInterval; //!< time between two fast failure detection probes
+  uint32_t m_detectMultiplier; //!< number of probe intervals without probe before a neighbor is lost
+  EventId m_probeEvent; //!< next fast failure detection tick
+  NeighborTable m_neighbors; //!< neighbor table
+  KeepAliveStates m_keepAlives; //!< keep-alive state of the interfaces with a socket
   // \}
 }; // PIO Routing Protocol
 }
@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include "ns3/test.h"
+#include "ns3/buffer.h"
+#include "ns3/pio-header.h"
+
+using namespace ns3;
+
+/**
+ * \param prefix prefix
+ * \param mask subnet mask
+ * \param sequenceNo sequence number
+ * \param metric route metric
+ * \return the RTE
+ */
+static PIORte
+MakeRte (const char *prefix, const char *mask, uint16_t sequenceNo, uint32_t metric)
+{
+  PIORte rte;
+  rte.SetPrefix (Ipv4Address (prefix));
+  rte.SetSubnetMask (Ipv4Mask (mask));
+  rte.SetSequenceNo (sequenceNo);
+  rte.SetRouteMetric (metric);
+  return rte;
+}
+
+/**
+ * \param header the header
+ * \return a buffer holding the serialized header
+ */
+static Buffer
+SerializeHeader (const PIOHeader &header)
+{
+  Buffer buffer;
+  buffer.AddAtStart (header.GetSerializedSize ());
+  header.Serialize (buffer.Begin ());
+  return buffer;
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Serialization of the packed route table entries, and decoding of
+ * truncated and malformed messages.
+ */
+class PIOHeaderCodecTestCase : public TestCase
+{
+public:
+  PIOHeaderCodecTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Check that decoded entries match the first entries sent.
+   * \param decoded the decoded header
+   * \param sent the header sent
+   */
+  void CheckRtes (const PIOHeader &decoded, const PIOHeader &sent);
+};
+
+PIOHeaderCodecTestCase::PIOHeaderCodecTestCase ()
+  : TestCase ("Packed route table entries")
+{
+}
+
+void
+PIOHeaderCodecTestCase::CheckRtes (const PIOHeader &decoded, const PIOHeader &sent)
+{
+  const std::vector<PIORte> &rtes = decoded.GetRteList ();
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (rtes.size (), sent.GetRteList ().size (), "more entries decoded than sent");
+  for (uint32_t n = 0; n < rtes.size () && n < sent.GetRteList ().size (); n++)
+    {
+      const PIORte &expected = sent.GetRteList ()[n];
+      NS_TEST_ASSERT_MSG_EQ (rtes[n].GetPrefix (), expected.GetPrefix (), "wrong prefix of entry " << n);
+      NS_TEST_ASSERT_MSG_EQ (rtes[n].GetSubnetMask (), expected.GetSubnetMask (), "wrong mask of entry " << n);
+      NS_TEST_ASSERT_MSG_EQ (rtes[n].GetSequenceNo (), expected.GetSequenceNo (), "wrong sequence number of entry " << n);
+      NS_TEST_ASSERT_MSG_EQ (rtes[n].GetRouteMetric (), expected.GetRouteMetric (), "wrong metric of entry " << n);
+    }
+}
+
+void
+PIOHeaderCodecTestCase::DoRun (void)
+{
+  PIOHeader header;
+  header.SetCommand (PIOHeader::RESPONSE);
+
+  // the first entry differs from the implicit zero sequence number and metric
+  header.AddRte (MakeRte ("10.0.0.0", "255.0.0.0", 5, 1));
+  // a /24 with the same sequence number and metric takes 4 bytes
+  PIORte same = MakeRte ("10.1.2.0", "255.255.255.0", 5, 1);
+  NS_TEST_ASSERT_MSG_EQ (header.GetRteSize (same), 4, "wrong size of an entry without deltas");
+  header.AddRte (same);
+  // negative deltas, a sequence number wrapping around and a large metric
+  header.AddRte (MakeRte ("0.0.0.0", "0.0.0.0", 65535, 0));
+  header.AddRte (MakeRte ("192.168.1.7", "255.255.255.255", 0, 0xffffffff));
+  header.AddRte (MakeRte ("172.16.0.0", "255.240.0.0", 300, 16));
+  header.AddRte (MakeRte ("10.1.2.128", "255.255.255.128", 299, 3));
+
+  Buffer buffer = SerializeHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), header.GetSerializedSize (), "wrong serialized size");
+
+  PIOHeader decoded;
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (buffer.Begin ()), header.GetSerializedSize (), "wrong deserialized size");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetCommand (), PIOHeader::RESPONSE, "wrong command");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRteNumber (), header.GetRteNumber (), "wrong number of entries");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetSerializedSize (), header.GetSerializedSize (), "wrong size of the decoded message");
+  CheckRtes (decoded, header);
+
+  // a truncated message decodes up to its last complete entry, and the
+  // size returned covers exactly the entries decoded
+  for (uint32_t cut = 1; cut < buffer.GetSize (); cut++)
+    {
+      Buffer truncated = buffer;
+      truncated.RemoveAtEnd (cut);
+      PIOHeader partial;
+      uint32_t size = partial.Deserialize (truncated.Begin ());
+      if (truncated.GetSize () < 4)
+        {
+          NS_TEST_ASSERT_MSG_EQ (size, 0, "truncated header decoded");
+          continue;
+        }
+      NS_TEST_ASSERT_MSG_LT (partial.GetRteNumber (), header.GetRteNumber (), "entries decoded past the end, cut " << cut);
+      NS_TEST_ASSERT_MSG_EQ (size, partial.GetSerializedSize (), "size does not match the entries decoded, cut " << cut);
+      NS_TEST_ASSERT_MSG_LT_OR_EQ (size, truncated.GetSize (), "size past the end, cut " << cut);
+      CheckRtes (partial, header);
+    }
+
+  // an entry claiming a prefix longer than 32 bits ends the decoding
+  PIOHeader single;
+  single.SetCommand (PIOHeader::RESPONSE);
+  single.AddRte (MakeRte ("10.0.0.0", "255.0.0.0", 1, 1));
+  Buffer malformed = SerializeHeader (single);
+  malformed.AddAtEnd (1);
+  Buffer::Iterator i = malformed.Begin ();
+  i.Next (2);
+  i.WriteHtonU16 (2);
+  i = malformed.End ();
+  i.Prev ();
+  i.WriteU8 (40);
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (malformed.Begin ()), single.GetSerializedSize (), "malformed entry consumed");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRteNumber (), 1, "malformed entry decoded");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetSerializedSize (), single.GetSerializedSize (), "wrong size of the decoded message");
+
+  // messages without entries
+  PIOHeader keepAlive;
+  keepAlive.SetCommand (PIOHeader::KEEP_ALIVE);
+  Buffer empty = SerializeHeader (keepAlive);
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (empty.Begin ()), 4, "wrong size of a keep-alive");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetCommand (), PIOHeader::KEEP_ALIVE, "wrong command");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRteNumber (), 0, "entries decoded from a keep-alive");
+
+  // a rejected message leaves nothing of the message decoded before it
+  Buffer badCommand = SerializeHeader (header);
+  badCommand.Begin ().WriteU8 (0x7f);
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (buffer.Begin ()), header.GetSerializedSize (), "wrong deserialized size");
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (badCommand.Begin ()), 0, "unknown command decoded");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetCommand (), PIOHeader::Command_e (0), "command of the previous message kept");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRteNumber (), 0, "entries of the previous message kept");
+
+  Buffer badVersion = SerializeHeader (header);
+  i = badVersion.Begin ();
+  i.Next ();
+  i.WriteU8 (0x7f);
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (buffer.Begin ()), header.GetSerializedSize (), "wrong deserialized size");
+  NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (badVersion.Begin ()), 0, "other version decoded");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetCommand (), PIOHeader::Command_e (0), "command of the previous message kept");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRteNumber (), 0, "entries of the previous message kept");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO header test suite
+ */
+class PIOHeaderTestSuite : public TestSuite
+{
+public:
+  PIOHeaderTestSuite () : TestSuite ("pio-header", UNIT)
+  {
+    AddTestCase (new PIOHeaderCodecTestCase, TestCase::QUICK);
+  }
+};
+
+static PIOHeaderTestSuite g_pioHeaderTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/pior-compiled-fib.h"
+
+#include "pior-test-utils.h"
+
+using namespace ns3;
+
+/// Prefix installed in the compiled table, as kept by the reference
+struct Prefix
+{
+  uint32_t network; //!< network address
+  uint8_t length; //!< prefix length
+  uint32_t group; //!< next-hop group
+  const PIORouteTrie::PathList *paths; //!< routes of the group members
+};
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief DIR-24-8 lookups of the compiled forwarding table, checked against
+ * a linear scan of the installed prefixes as they are set, updated and unset.
+ * Each group comes with its own member list, so that a lookup returning the
+ * member list of another prefix is caught.
+ */
+class PIOCompiledFibLookupTestCase : public TestCase
+{
+public:
+  PIOCompiledFibLookupTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Compare the table lookups with the linear scan for the boundaries
+   * of every prefix and random addresses.
+   * \param fib the compiled table
+   * \param prefixes the installed prefixes
+   * \param state random generator state
+   */
+  void CheckLookups (const PIOCompiledFib &fib, const std::vector<Prefix> &prefixes, uint32_t &state);
+
+  /**
+   * \param prefixes the installed prefixes
+   * \param network network address
+   * \param length prefix length
+   * \return the index of the prefix, or prefixes.size () if it is not installed
+   */
+  static uint32_t FindPrefix (const std::vector<Prefix> &prefixes, uint32_t network, uint8_t length);
+};
+
+PIOCompiledFibLookupTestCase::PIOCompiledFibLookupTestCase ()
+  : TestCase ("DIR-24-8 lookups against a linear scan")
+{
+}
+
+uint32_t
+PIOCompiledFibLookupTestCase::FindPrefix (const std::vector<Prefix> &prefixes, uint32_t network, uint8_t length)
+{
+  uint32_t i = 0;
+  while (i < prefixes.size () && !(prefixes[i].network == network && prefixes[i].length == length))
+    {
+      i++;
+    }
+  return i;
+}
+
+void
+PIOCompiledFibLookupTestCase::CheckLookups (const PIOCompiledFib &fib, const std::vector<Prefix> &prefixes, uint32_t &state)
+{
+  NS_TEST_ASSERT_MSG_EQ (fib.GetNPrefixes (), prefixes.size (), "wrong prefix count");
+
+  std::vector<uint32_t> addresses;
+  for (std::vector<Prefix>::const_iterator it = prefixes.begin (); it != prefixes.end (); it++)
+    {
+      uint32_t last = it->network | ~MaskOf (it->length);
+      addresses.push_back (it->network);
+      addresses.push_back (it->network - 1);
+      addresses.push_back (last);
+      addresses.push_back (last + 1);
+    }
+  for (uint32_t i = 0; i < 500; i++)
+    {
+      addresses.push_back (NextRandom (state));
+    }
+
+  for (std::vector<uint32_t>::const_iterator address = addresses.begin (); address != addresses.end (); address++)
+    {
+      const Prefix *expected = 0;
+      for (std::vector<Prefix>::const_iterator it = prefixes.begin (); it != prefixes.end (); it++)
+        {
+          if ((*address & MaskOf (it->length)) == it->network && (expected == 0 || it->length > expected->length))
+            {
+              expected = &*it;
+            }
+        }
+
+      uint8_t length = 0xff;
+      const PIORouteTrie::PathList *paths = 0;
+      uint32_t group = fib.Lookup (Ipv4Address (*address), length, paths);
+      if (expected == 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (group, PIOCompiledFib::NONE, "unexpected match for " << Ipv4Address (*address));
+          continue;
+        }
+      NS_TEST_ASSERT_MSG_EQ (group, expected->group, "wrong group for " << Ipv4Address (*address));
+      NS_TEST_ASSERT_MSG_EQ (int (length), int (expected->length), "wrong prefix length for " << Ipv4Address (*address));
+      NS_TEST_ASSERT_MSG_EQ (paths, expected->paths, "wrong member routes for " << Ipv4Address (*address));
+    }
+}
+
+void
+PIOCompiledFibLookupTestCase::DoRun (void)
+{
+  PIOCompiledFib fib;
+  std::vector<Prefix> prefixes;
+  uint32_t state = 7;
+
+  // member lists by group, only their addresses are stored
+  PIORouteArena arena;
+  std::vector<PIORouteTrie::PathList> lists (2000, PIORouteTrie::PathList (PIOArenaAllocator<PIORoutingEntry*> (&arena)));
+
+  uint8_t length = 0;
+  const PIORouteTrie::PathList *paths = 0;
+  NS_TEST_ASSERT_MSG_EQ (fib.Lookup (Ipv4Address ("10.0.0.1"), length, paths), PIOCompiledFib::NONE, "match in an empty table");
+  NS_TEST_ASSERT_MSG_EQ (fib.Unset (Ipv4Address ("10.0.0.0"), 8), PIOCompiledFib::NONE, "unset a prefix never set");
+
+  // half of the prefixes fall in 10.1.0.0/16 so that they nest, and many of
+  // them are longer than 24 bits so that the /24 slots expand into tbl8 groups
+  for (uint32_t i = 0; i < 400; i++)
+    {
+      Prefix prefix;
+      uint32_t address = NextRandom (state);
+      if (i % 2 == 0)
+        {
+          prefix.length = NextRandom (state) % 33;
+        }
+      else
+        {
+          prefix.length = 16 + NextRandom (state) % 17;
+          address = 0x0a010000 | (address & 0xffff);
+        }
+      prefix.network = address & MaskOf (prefix.length);
+      prefix.group = i;
+      prefix.paths = &lists[i];
+      if (FindPrefix (prefixes, prefix.network, prefix.length) != prefixes.size ())
+        {
+          continue;
+        }
+      NS_TEST_ASSERT_MSG_EQ (fib.Set (Ipv4Address (address), prefix.length, prefix.group, prefix.paths), PIOCompiledFib::NONE,
+                             "new prefix reported as installed");
+      prefixes.push_back (prefix);
+
+      if (prefixes.size () % 100 == 0)
+        {
+          CheckLookups (fib, prefixes, state);
+        }
+    }
+  CheckLookups (fib, prefixes, state);
+
+  // changing the group of a prefix only rewrites its record
+  for (uint32_t i = 0; i < prefixes.size (); i += 3)
+    {
+      uint32_t group = 1000 + i;
+      NS_TEST_ASSERT_MSG_EQ (fib.Set (Ipv4Address (prefixes[i].network), prefixes[i].length, group, &lists[group]),
+                             prefixes[i].group, "wrong previous group");
+      prefixes[i].group = group;
+      prefixes[i].paths = &lists[group];
+    }
+  CheckLookups (fib, prefixes, state);
+
+  // withdraw the prefixes in random order, the slots falling back to the
+  // shorter prefixes
+  while (!prefixes.empty ())
+    {
+      uint32_t index = NextRandom (state) % prefixes.size ();
+      Prefix prefix = prefixes[index];
+      prefixes.erase (prefixes.begin () + index);
+
+      NS_TEST_ASSERT_MSG_EQ (fib.Unset (Ipv4Address (prefix.network), prefix.length), prefix.group, "wrong withdrawn group");
+      NS_TEST_ASSERT_MSG_EQ (fib.Unset (Ipv4Address (prefix.network), prefix.length), PIOCompiledFib::NONE,
+                             "prefix withdrawn twice");
+
+      if (prefixes.size () % 40 == 0)
+        {
+          CheckLookups (fib, prefixes, state);
+        }
+    }
+
+  // a table emptied by withdrawals is still usable
+  NS_TEST_ASSERT_MSG_EQ (fib.Set (Ipv4Address ("10.1.2.3"), 32, 5, &lists[5]), PIOCompiledFib::NONE, "new prefix reported as installed");
+  NS_TEST_ASSERT_MSG_EQ (fib.Lookup (Ipv4Address ("10.1.2.3"), length, paths), 5, "wrong group for 10.1.2.3");
+  NS_TEST_ASSERT_MSG_EQ (paths, &lists[5], "wrong member routes for 10.1.2.3");
+  NS_TEST_ASSERT_MSG_EQ (fib.Lookup (Ipv4Address ("10.1.2.4"), length, paths), PIOCompiledFib::NONE, "unexpected match for 10.1.2.4");
+
+  fib.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (fib.GetNPrefixes (), 0, "prefixes left after Clear");
+  NS_TEST_ASSERT_MSG_EQ (fib.Lookup (Ipv4Address ("10.1.2.3"), length, paths), PIOCompiledFib::NONE, "match after Clear");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO compiled forwarding table test suite
+ */
+class PIOCompiledFibTestSuite : public TestSuite
+{
+public:
+  PIOCompiledFibTestSuite () : TestSuite ("pio-compiled-fib", UNIT)
+  {
+    AddTestCase (new PIOCompiledFibLookupTestCase, TestCase::QUICK);
+  }
+};
+
+static PIOCompiledFibTestSuite g_pioCompiledFibTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/pior.h"
+#include "ns3/pior-helper.h"
+
+using namespace ns3;
+
+/// Route expected from a line of the dump
+struct ExpectedRoute
+{
+  const char *network; //!< network address
+  const char *mask; //!< network mask
+  const char *gateway; //!< next hop, 0.0.0.0 for none
+  uint32_t interface; //!< interface index
+  uint16_t metric; //!< metric
+};
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Parsing of a plain-text route dump: gateways, metrics, skipped
+ * keywords and flags, and rejected lines.
+ */
+class PIORouteDumpTestCase : public TestCase
+{
+public:
+  PIORouteDumpTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Load the dump on a fresh node and compare the installed routes.
+   * \param filename the route dump
+   * \param interfaces ifindex map given to LoadRouteDump
+   * \param expected the routes expected, in the order of the dump
+   * \param nExpected the number of routes expected
+   */
+  void CheckDump (std::string filename, const std::map<uint32_t, uint32_t> &interfaces,
+                  const ExpectedRoute *expected, uint32_t nExpected);
+};
+
+PIORouteDumpTestCase::PIORouteDumpTestCase ()
+  : TestCase ("Route dump parser")
+{
+}
+
+void
+PIORouteDumpTestCase::CheckDump (std::string filename, const std::map<uint32_t, uint32_t> &interfaces,
+                                 const ExpectedRoute *expected, uint32_t nExpected)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  PIOHelper pio;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (pio);
+  internet.Install (node);
+
+  Ptr<PIORoutingProtocol> routing = pio.GetPIORouting (node->GetObject<Ipv4> ());
+  NS_TEST_ASSERT_MSG_EQ (routing != 0, true, "PIO routing not installed");
+
+  // the routes installed by the dump are the most recent ones
+  std::vector<PIOSnapshotRecord> before;
+  routing->SaveRoutes (node->GetId (), before);
+
+  uint32_t added = pio.LoadRouteDump (node, filename, interfaces);
+  NS_TEST_ASSERT_MSG_EQ (added, nExpected, "wrong number of routes installed");
+
+  std::vector<PIOSnapshotRecord> after;
+  routing->SaveRoutes (node->GetId (), after);
+  NS_TEST_ASSERT_MSG_EQ (after.size (), before.size () + nExpected, "wrong number of routes in the table");
+  for (uint32_t i = 0; i < nExpected && before.size () + i < after.size (); i++)
+    {
+      const PIOSnapshotRecord &record = after[before.size () + i];
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Address (record.network), Ipv4Address (expected[i].network), "wrong network of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Mask (record.mask), Ipv4Mask (expected[i].mask), "wrong mask of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Address (record.gateway), Ipv4Address (expected[i].gateway), "wrong gateway of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.interface, expected[i].interface, "wrong interface of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.metric, expected[i].metric, "wrong metric of route " << i);
+    }
+}
+
+void
+PIORouteDumpTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("pio-route-dump.txt");
+  std::ofstream dump (filename.c_str ());
+  dump << "# ip route show\n"
+       << "default via 192.168.0.1 dev 1\n"
+       << "10.1.0.0/16 via 192.168.0.2 dev 2 metric 3\n"
+       << "10.2.0.0/16 via 192.168.0.2 dev 2 7\n"
+       << "\n"
+       << "10.3.0.0/24 dev 1 proto kernel scope link src 10.3.0.1\n"
+       << "10.4.0.0/24 via 192.168.0.3 dev 2 onlink metric 5\n"
+       << "  10.5.0.0/24 via 192.168.0.3 dev 2 linkdown metric 6 mtu lock 1400\n"
+       << "192.168.7.7 dev 3 dead\n"
+       << "10.6.0.0/24 via 192.168.0.3 dev 2 bogus 5\n"
+       << "10.7.0.0/33 dev 1\n"
+       << "10.8.0.0/24 via 192.168.0.3\n"
+       << "10.9.0.0/24 via 192.168.0.3 dev 2 metric\n"
+       << "10.9.1.0/24 dev 2 metric 70000\n"
+       << "10.9.2.0/24 via 192.168.0 dev 2\n"
+       << "10.10.0.0/24 dev 9 table 5\n"
+       << "10.11.1.1/24 dev 1\n"
+       << "10.12.0.0/16 dev 2 metric 1";
+  dump.close ();
+
+  const ExpectedRoute all[] = {
+    { "0.0.0.0", "0.0.0.0", "192.168.0.1", 1, 0 },
+    { "10.1.0.0", "255.255.0.0", "192.168.0.2", 2, 3 },
+    { "10.2.0.0", "255.255.0.0", "192.168.0.2", 2, 7 },
+    { "10.3.0.0", "255.255.255.0", "0.0.0.0", 1, 0 },
+    { "10.4.0.0", "255.255.255.0", "192.168.0.3", 2, 5 },
+    { "10.5.0.0", "255.255.255.0", "192.168.0.3", 2, 6 },
+    { "192.168.7.7", "255.255.255.255", "0.0.0.0", 3, 0 },
+    { "10.10.0.0", "255.255.255.0", "0.0.0.0", 9, 0 },
+    { "10.11.1.0", "255.255.255.0", "0.0.0.0", 1, 0 },
+    { "10.12.0.0", "255.255.0.0", "0.0.0.0", 2, 1 },
+  };
+  CheckDump (filename, std::map<uint32_t, uint32_t> (), all, sizeof (all) / sizeof (all[0]));
+
+  // ifindex 9 is not mapped, 2 is mapped to 4
+  std::map<uint32_t, uint32_t> interfaces;
+  interfaces[1] = 1;
+  interfaces[2] = 4;
+  interfaces[3] = 3;
+  const ExpectedRoute mapped[] = {
+    { "0.0.0.0", "0.0.0.0", "192.168.0.1", 1, 0 },
+    { "10.1.0.0", "255.255.0.0", "192.168.0.2", 4, 3 },
+    { "10.2.0.0", "255.255.0.0", "192.168.0.2", 4, 7 },
+    { "10.3.0.0", "255.255.255.0", "0.0.0.0", 1, 0 },
+    { "10.4.0.0", "255.255.255.0", "192.168.0.3", 4, 5 },
+    { "10.5.0.0", "255.255.255.0", "192.168.0.3", 4, 6 },
+    { "192.168.7.7", "255.255.255.255", "0.0.0.0", 3, 0 },
+    { "10.11.1.0", "255.255.255.0", "0.0.0.0", 1, 0 },
+    { "10.12.0.0", "255.255.0.0", "0.0.0.0", 4, 1 },
+  };
+  CheckDump (filename, interfaces, mapped, sizeof (mapped) / sizeof (mapped[0]));
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO route dump test suite
+ */
+class PIORouteDumpTestSuite : public TestSuite
+{
+public:
+  PIORouteDumpTestSuite () : TestSuite ("pio-route-dump", UNIT)
+  {
+    AddTestCase (new PIORouteDumpTestCase, TestCase::QUICK);
+  }
+};
+
+static PIORouteDumpTestSuite g_pioRouteDumpTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,329 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/pior.h"
+#include "ns3/pior-route-trie.h"
+
+#include "pior-test-utils.h"
+
+using namespace ns3;
+
+/**
+ * \brief Route filter accepting every route but those of one interface.
+ */
+struct InterfaceFilter
+{
+  InterfaceFilter (uint32_t excluded) : m_excluded (excluded)
+  {
+  }
+
+  bool operator () (const PIORoutingEntry *route) const
+  {
+    return route->GetInterface () != m_excluded;
+  }
+
+  uint32_t m_excluded; //!< interface whose routes are rejected
+};
+
+/**
+ * \brief Group selector picking one member in one group, see
+ * PIORouteTrie::LookupGroup.
+ */
+struct MemberSelector
+{
+  MemberSelector (uint32_t group, uint32_t member) : m_group (group),
+                                                     m_member (member)
+  {
+  }
+
+  uint32_t operator () (uint32_t group) const
+  {
+    return group == m_group ? m_member : PIORouteTrie::NONE;
+  }
+
+  uint32_t m_group; //!< group whose member is picked
+  uint32_t m_member; //!< index of the member picked
+};
+
+/**
+ * \brief Longest-prefix match by a scan of every route.
+ * \param routes the routes
+ * \param address destination address
+ * \param filter route filter
+ * \return the length of the longest prefix having an accepted route covering
+ * the address, or -1 if none
+ */
+static int
+LinearLookup (const std::vector<PIORoutingEntry*> &routes, uint32_t address, InterfaceFilter filter)
+{
+  int best = -1;
+  for (std::vector<PIORoutingEntry*>::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      uint8_t length = (*it)->GetDestNetworkMask ().GetPrefixLength ();
+      if (filter (*it) && (address & MaskOf (length)) == (*it)->GetDestNetwork ().Get () && int (length) > best)
+        {
+          best = length;
+        }
+    }
+  return best;
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Longest-prefix match of the route trie, checked against a linear
+ * scan of the routes as they are inserted and removed.
+ */
+class PIORouteTrieLookupTestCase : public TestCase
+{
+public:
+  PIORouteTrieLookupTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Compare the trie lookups with the linear scan for fixed and
+   * random addresses.
+   * \param trie the trie
+   * \param routes the routes held by the trie
+   * \param state random generator state
+   */
+  void CheckLookups (const PIORouteTrie &trie, const std::vector<PIORoutingEntry*> &routes, uint32_t &state);
+};
+
+PIORouteTrieLookupTestCase::PIORouteTrieLookupTestCase ()
+  : TestCase ("Longest-prefix match against a linear scan")
+{
+}
+
+void
+PIORouteTrieLookupTestCase::CheckLookups (const PIORouteTrie &trie, const std::vector<PIORoutingEntry*> &routes, uint32_t &state)
+{
+  std::vector<uint32_t> addresses;
+  for (std::vector<PIORoutingEntry*>::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      // the first and last address of every prefix, and the addresses around them
+      uint32_t network = (*it)->GetDestNetwork ().Get ();
+      uint32_t last = network | ~(*it)->GetDestNetworkMask ().Get ();
+      addresses.push_back (network);
+      addresses.push_back (network - 1);
+      addresses.push_back (last);
+      addresses.push_back (last + 1);
+    }
+  for (uint32_t i = 0; i < 500; i++)
+    {
+      addresses.push_back (NextRandom (state));
+    }
+
+  for (uint32_t excluded = 0; excluded < 2; excluded++)
+    {
+      // interface 2 is never used: the first pass accepts every route
+      InterfaceFilter filter (excluded == 0 ? 2 : 1);
+      for (std::vector<uint32_t>::const_iterator address = addresses.begin (); address != addresses.end (); address++)
+        {
+          int expected = LinearLookup (routes, *address, filter);
+          const PIORouteTrie::RouteList* found = trie.Lookup (Ipv4Address (*address), filter);
+          if (expected < 0)
+            {
+              NS_TEST_ASSERT_MSG_EQ (found == 0, true, "unexpected match for " << Ipv4Address (*address));
+              continue;
+            }
+          NS_TEST_ASSERT_MSG_EQ (found != 0, true, "no match for " << Ipv4Address (*address));
+          if (found != 0)
+            {
+              NS_TEST_ASSERT_MSG_EQ (int (found->front ()->GetDestNetworkMask ().GetPrefixLength ()), expected,
+                                     "wrong prefix length for " << Ipv4Address (*address));
+              NS_TEST_ASSERT_MSG_EQ (found->front ()->GetDestNetwork ().Get (), *address & MaskOf (expected),
+                                     "wrong prefix for " << Ipv4Address (*address));
+            }
+        }
+    }
+}
+
+void
+PIORouteTrieLookupTestCase::DoRun (void)
+{
+  PIORouteArena arena;
+  PIORouteTrie trie (&arena);
+  std::vector<PIORoutingEntry*> routes;
+  uint32_t state = 1;
+
+  // nested, adjacent and host prefixes, and the default route
+  const char *prefixes[] = { "0.0.0.0/0", "10.0.0.0/8", "10.1.0.0/16", "10.1.2.0/24", "10.1.2.128/25",
+                             "10.1.2.129/32", "10.1.3.0/24", "172.16.0.0/12", "192.168.0.0/16",
+                             "192.168.1.0/24", "255.255.255.255/32" };
+  for (uint32_t i = 0; i < sizeof (prefixes) / sizeof (prefixes[0]); i++)
+    {
+      std::string prefix (prefixes[i]);
+      std::string::size_type slash = prefix.find ('/');
+      Ipv4Mask mask (prefix.substr (slash).c_str ());
+      routes.push_back (new PIORoutingEntry (Ipv4Address (prefix.substr (0, slash).c_str ()), mask, i % 2));
+    }
+  for (uint32_t i = 0; i < 300; i++)
+    {
+      uint8_t length = NextRandom (state) % 33;
+      routes.push_back (new PIORoutingEntry (Ipv4Address (NextRandom (state) & MaskOf (length)), Ipv4Mask (MaskOf (length)), i % 2));
+    }
+  for (std::vector<PIORoutingEntry*>::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      trie.Insert (*it);
+    }
+
+  CheckLookups (trie, routes, state);
+
+  // exact matches
+  for (std::vector<PIORoutingEntry*>::const_iterator it = routes.begin (); it != routes.end (); it++)
+    {
+      const PIORouteTrie::RouteList* found = trie.Find ((*it)->GetDestNetwork (), (*it)->GetDestNetworkMask ());
+      NS_TEST_ASSERT_MSG_EQ (found != 0 && std::find (found->begin (), found->end (), *it) != found->end (), true,
+                             "route to " << (*it)->GetDestNetwork () << (*it)->GetDestNetworkMask () << " not found");
+    }
+  NS_TEST_ASSERT_MSG_EQ (trie.Find (Ipv4Address ("10.1.2.0"), Ipv4Mask ("/23")) == 0, true, "found a prefix never inserted");
+
+  // remove the routes in random order
+  while (!routes.empty ())
+    {
+      uint32_t index = NextRandom (state) % routes.size ();
+      PIORoutingEntry *route = routes[index];
+      routes.erase (routes.begin () + index);
+
+      NS_TEST_ASSERT_MSG_EQ (trie.Remove (route), true, "route not removed");
+      NS_TEST_ASSERT_MSG_EQ (trie.Remove (route), false, "route removed twice");
+      delete route;
+
+      if (routes.size () % 50 == 0)
+        {
+          CheckLookups (trie, routes, state);
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), 0, "prefixes left in an empty trie");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 0, "nodes left in an empty trie");
+  NS_TEST_ASSERT_MSG_EQ (arena.GetBytesInUse (), 0, "trie nodes not returned to the arena");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Pruning of the route trie nodes on removal and group changes, and
+ * FIB lookups ending on the routes of the group members.
+ */
+class PIORouteTriePruneTestCase : public TestCase
+{
+public:
+  PIORouteTriePruneTestCase ();
+  virtual void DoRun (void);
+};
+
+PIORouteTriePruneTestCase::PIORouteTriePruneTestCase ()
+  : TestCase ("Pruning of the trie nodes")
+{
+}
+
+void
+PIORouteTriePruneTestCase::DoRun (void)
+{
+  PIORouteArena arena;
+  PIORouteTrie trie (&arena);
+  PIORoutingEntry a (Ipv4Address ("10.0.0.0"), Ipv4Mask ("/24"), 1);
+  PIORoutingEntry b (Ipv4Address ("10.0.1.0"), Ipv4Mask ("/24"), 1);
+  PIORoutingEntry c (Ipv4Address ("10.0.1.0"), Ipv4Mask ("/24"), Ipv4Address ("10.0.0.1"), 1);
+  PIORoutingEntry d (Ipv4Address ("10.0.0.0"), Ipv4Mask ("/16"), 1);
+
+  // two diverging prefixes need a branch node
+  trie.Insert (&a);
+  trie.Insert (&b);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 3, "no branch node for 10.0.0.0/24 and 10.0.1.0/24");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), 2, "wrong prefix count");
+
+  // a second route of a prefix shares its node, most recent first
+  trie.Insert (&c);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 3, "node added for an existing prefix");
+  const PIORouteTrie::RouteList* routes = trie.Find (Ipv4Address ("10.0.1.0"), Ipv4Mask ("/24"));
+  NS_TEST_ASSERT_MSG_EQ (routes != 0 && routes->size () == 2 && routes->front () == &c, true, "wrong routes for 10.0.1.0/24");
+
+  // a covering prefix is inserted above the branch node
+  trie.Insert (&d);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 4, "wrong node count with 10.0.0.0/16");
+
+  // a FIB lookup returns the route of the member selected, and falls back to
+  // the shorter prefixes when no member of a group is selected
+  std::vector<PIORoutingEntry*> paths;
+  paths.push_back (&c);
+  paths.push_back (&b);
+  trie.SetGroup (Ipv4Address ("10.0.1.0"), 24, 4, paths);
+  paths.assign (1, &d);
+  trie.SetGroup (Ipv4Address ("10.0.0.0"), 16, 5, paths);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetPaths (Ipv4Address ("10.0.1.0"), 24)->size (), 2, "wrong member routes for 10.0.1.0/24");
+  NS_TEST_ASSERT_MSG_EQ (trie.LookupGroup (Ipv4Address ("10.0.1.9"), MemberSelector (4, 1)), &b, "wrong route of member 1");
+  NS_TEST_ASSERT_MSG_EQ (trie.LookupGroup (Ipv4Address ("10.0.1.9"), MemberSelector (4, 0)), &c, "wrong route of member 0");
+  NS_TEST_ASSERT_MSG_EQ (trie.LookupGroup (Ipv4Address ("10.0.1.9"), MemberSelector (5, 0)), &d, "no fallback to 10.0.0.0/16");
+  NS_TEST_ASSERT_MSG_EQ (trie.LookupGroup (Ipv4Address ("10.1.0.1"), MemberSelector (5, 0)), 0, "match outside the prefixes");
+  trie.SetGroup (Ipv4Address ("10.0.1.0"), 24, PIORouteTrie::NONE);
+  trie.SetGroup (Ipv4Address ("10.0.0.0"), 16, PIORouteTrie::NONE);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetPaths (Ipv4Address ("10.0.1.0"), 24) == 0, true, "member routes left without a group");
+
+  trie.Remove (&b);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 4, "node of a prefix still holding a route pruned");
+  trie.Remove (&c);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 2, "empty prefix and branch node not pruned");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), 2, "wrong prefix count");
+
+  // a prefix without routes keeps its node while it has a group
+  trie.SetGroup (Ipv4Address ("10.0.0.0"), 24, 7);
+  trie.Remove (&a);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 2, "node holding a group pruned");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetGroup (Ipv4Address ("10.0.0.0"), 24), 7, "group lost");
+  NS_TEST_ASSERT_MSG_EQ (trie.Find (Ipv4Address ("10.0.0.0"), Ipv4Mask ("/24")) == 0, true, "routes left for 10.0.0.0/24");
+  NS_TEST_ASSERT_MSG_EQ (trie.SetGroup (Ipv4Address ("10.0.0.0"), 24, PIORouteTrie::NONE), 7, "wrong previous group");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 1, "node without routes nor group not pruned");
+
+  // a group set on a prefix without routes creates its node
+  trie.SetGroup (Ipv4Address ("10.0.128.0"), 17, 3);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 2, "no node for a group");
+  NS_TEST_ASSERT_MSG_EQ (trie.SetGroup (Ipv4Address ("10.0.128.0"), 17, PIORouteTrie::NONE), 3, "wrong previous group");
+
+  trie.Remove (&d);
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 0, "nodes left in an empty trie");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), 0, "prefixes left in an empty trie");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO route trie test suite
+ */
+class PIORouteTrieTestSuite : public TestSuite
+{
+public:
+  PIORouteTrieTestSuite () : TestSuite ("pio-route-trie", UNIT)
+  {
+    AddTestCase (new PIORouteTrieLookupTestCase, TestCase::QUICK);
+    AddTestCase (new PIORouteTriePruneTestCase, TestCase::QUICK);
+  }
+};
+
+static PIORouteTrieTestSuite g_pioRouteTrieTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,197 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node-container.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/pior.h"
+#include "ns3/pior-helper.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Snapshot of the routing tables of several nodes written and loaded
+ * back on fresh nodes, and rejection of damaged snapshot files.
+ */
+class PIOSnapshotTestCase : public TestCase
+{
+public:
+  PIOSnapshotTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Create nodes running PIO.
+   * \param pio the helper
+   * \return the nodes
+   */
+  static NodeContainer CreateNodes (const PIOHelper &pio);
+
+  /**
+   * \param pio the helper
+   * \param nodes the nodes
+   * \return the routes of the nodes, as written in a snapshot
+   */
+  static std::vector<PIOSnapshotRecord> SaveRoutes (const PIOHelper &pio, NodeContainer nodes);
+};
+
+PIOSnapshotTestCase::PIOSnapshotTestCase ()
+  : TestCase ("Snapshot round trip")
+{
+}
+
+NodeContainer
+PIOSnapshotTestCase::CreateNodes (const PIOHelper &pio)
+{
+  NodeContainer nodes;
+  nodes.Create (3);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (pio);
+  internet.Install (nodes);
+  return nodes;
+}
+
+std::vector<PIOSnapshotRecord>
+PIOSnapshotTestCase::SaveRoutes (const PIOHelper &pio, NodeContainer nodes)
+{
+  std::vector<PIOSnapshotRecord> records;
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      pio.GetPIORouting ((*i)->GetObject<Ipv4> ())->SaveRoutes ((*i)->GetId (), records);
+    }
+  return records;
+}
+
+void
+PIOSnapshotTestCase::DoRun (void)
+{
+  PIOHelper pio;
+  NodeContainer nodes = CreateNodes (pio);
+  std::vector<uint32_t> ids;
+
+  // the routes installed with the interfaces are in the snapshot too, and
+  // are already on the fresh nodes the snapshot is loaded on
+  std::vector<PIOSnapshotRecord> before = SaveRoutes (pio, nodes);
+
+  // permanent and expiring routes, with and without gateway, on each node
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      std::vector<PIORouteSpec> routes;
+      for (uint32_t i = 0; i < 4; i++)
+        {
+          Ipv4Address network (0x0a000000 | (n << 16) | (i << 8));
+          Time timeout = (i % 2 == 0) ? Seconds (0) : Seconds (180);
+          Time garbage = (i % 2 == 0) ? Seconds (0) : Seconds (120);
+          if (i < 2)
+            {
+              routes.push_back (PIORouteSpec (network, Ipv4Mask ("255.255.255.0"), 0, i + 1, 2 * n + i, timeout, garbage));
+            }
+          else
+            {
+              routes.push_back (PIORouteSpec (network, Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.0.1"), 0, i + 1, 2 * n + i,
+                                              timeout, garbage));
+            }
+        }
+      Ptr<PIORoutingProtocol> routing = pio.GetPIORouting (nodes.Get (n)->GetObject<Ipv4> ());
+      NS_TEST_ASSERT_MSG_EQ (routing->AddRoutes (routes), routes.size (), "routes not installed on node " << n);
+      ids.push_back (nodes.Get (n)->GetId ());
+    }
+  std::vector<PIOSnapshotRecord> expected = SaveRoutes (pio, nodes);
+  NS_TEST_ASSERT_MSG_EQ (expected.size (), before.size () + 12, "wrong number of routes saved");
+  uint32_t permanent = 0;
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      permanent += expected[i].flags & PIOSnapshotRecord::PERMANENT;
+    }
+  NS_TEST_ASSERT_MSG_EQ (permanent, expected.size () - 6, "expiring routes flagged permanent");
+
+  std::string filename = CreateTempDirFilename ("pio-snapshot.bin");
+  pio.WriteSnapshot (filename, nodes);
+
+  std::ifstream file (filename.c_str (), std::ios::binary);
+  std::vector<char> data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  file.close ();
+  NS_TEST_ASSERT_MSG_EQ (data.size (), sizeof (PIOSnapshotHeader) + expected.size () * sizeof (PIOSnapshotRecord), "wrong snapshot size");
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&data[0], data.size ()), true, "snapshot rejected");
+
+  // damaged files
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&data[0], data.size () - 1), false, "truncated record accepted");
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&data[0], sizeof (PIOSnapshotHeader) - 1), false, "truncated header accepted");
+  std::vector<char> damaged = data;
+  reinterpret_cast<PIOSnapshotHeader*> (&damaged[0])->magic ^= 0xff;
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&damaged[0], damaged.size ()), false, "bad magic accepted");
+  damaged = data;
+  reinterpret_cast<PIOSnapshotHeader*> (&damaged[0])->version++;
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&damaged[0], damaged.size ()), false, "other version accepted");
+  damaged = data;
+  reinterpret_cast<PIOSnapshotHeader*> (&damaged[0])->recordSize--;
+  NS_TEST_ASSERT_MSG_EQ (PIOHelper::CheckSnapshot (&damaged[0], damaged.size ()), false, "other record size accepted");
+
+  // fresh nodes get the ids of the nodes destroyed with the simulator
+  Simulator::Destroy ();
+  nodes = CreateNodes (pio);
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (nodes.Get (n)->GetId (), ids[n], "node ids not reused");
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (pio.LoadSnapshot (filename, nodes), 12, "wrong number of routes loaded");
+  std::vector<PIOSnapshotRecord> loaded = SaveRoutes (pio, nodes);
+  NS_TEST_ASSERT_MSG_EQ (loaded.size (), expected.size (), "wrong number of routes after loading");
+  for (uint32_t i = 0; i < loaded.size () && i < expected.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (loaded[i].node, expected[i].node, "wrong node of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Address (loaded[i].network), Ipv4Address (expected[i].network), "wrong network of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Mask (loaded[i].mask), Ipv4Mask (expected[i].mask), "wrong mask of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (Ipv4Address (loaded[i].gateway), Ipv4Address (expected[i].gateway), "wrong gateway of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (loaded[i].interface, expected[i].interface, "wrong interface of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (loaded[i].flags, expected[i].flags, "wrong flags of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (loaded[i].metric, expected[i].metric, "wrong metric of route " << i);
+      NS_TEST_EXPECT_MSG_EQ (loaded[i].sequenceNo, expected[i].sequenceNo, "wrong sequence number of route " << i);
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO snapshot test suite
+ */
+class PIOSnapshotTestSuite : public TestSuite
+{
+public:
+  PIOSnapshotTestSuite () : TestSuite ("pio-snapshot", UNIT)
+  {
+    AddTestCase (new PIOSnapshotTestCase, TestCase::QUICK);
+  }
+};
+
+static PIOSnapshotTestSuite g_pioSnapshotTestSuite; //!< Static variable for test initialization
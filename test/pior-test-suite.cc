@@ -0,0 +1,419 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/packet.h"
+#include "ns3/enum.h"
+#include "ns3/pior.h"
+#include "ns3/pior-helper.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Size of a routing record, as documented by PIORoutingEntry.
+ */
+class PIORoutingEntrySizeTestCase : public TestCase
+{
+public:
+  PIORoutingEntrySizeTestCase ();
+  virtual void DoRun (void);
+};
+
+PIORoutingEntrySizeTestCase::PIORoutingEntrySizeTestCase ()
+  : TestCase ("Size of a routing record")
+{
+}
+
+void
+PIORoutingEntrySizeTestCase::DoRun (void)
+{
+  // only what PIO adds to Ipv4RoutingTableEntry: 16 bytes of fields and
+  // padding, and the shared Ipv4Route
+  if (sizeof (void *) == 8)
+    {
+      NS_TEST_ASSERT_MSG_EQ (sizeof (PIORoutingEntry) - sizeof (Ipv4RoutingTableEntry), 24,
+                             "PIORoutingEntry no longer adds 24 bytes to Ipv4RoutingTableEntry");
+    }
+}
+
+/**
+ * \param routing the routing protocol
+ * \param network network address
+ * \param interface interface index
+ * \return true if a route without gateway to the network through the
+ * interface is in the table and not INVALID
+ */
+static bool
+HasRoute (Ptr<PIORoutingProtocol> routing, const char *network, uint32_t interface)
+{
+  std::vector<PIOSnapshotRecord> records;
+  routing->SaveRoutes (0, records);
+  for (std::vector<PIOSnapshotRecord>::const_iterator it = records.begin (); it != records.end (); it++)
+    {
+      if (Ipv4Address (it->network) == Ipv4Address (network) && it->gateway == 0 && it->interface == interface)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief The connected routes follow the interface state, and the routes
+ * without gateway added by the user are left alone.
+ */
+class PIOConnectedRouteTestCase : public TestCase
+{
+public:
+  PIOConnectedRouteTestCase ();
+  virtual void DoRun (void);
+};
+
+PIOConnectedRouteTestCase::PIOConnectedRouteTestCase ()
+  : TestCase ("Connected routes")
+{
+}
+
+void
+PIOConnectedRouteTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  node->AddDevice (device);
+
+  PIOHelper pio;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (pio);
+  internet.Install (node);
+
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  Ptr<PIORoutingProtocol> routing = pio.GetPIORouting (ipv4);
+  NS_TEST_ASSERT_MSG_EQ (routing != 0, true, "PIO routing not installed");
+
+  uint32_t interface = ipv4->AddInterface (device);
+  ipv4->AddAddress (interface, Ipv4InterfaceAddress (Ipv4Address ("10.1.1.1"), Ipv4Mask ("255.255.255.0")));
+  ipv4->SetUp (interface);
+  routing->AddNetworkRouteTo (Ipv4Address ("10.2.0.0"), Ipv4Mask ("255.255.0.0"), interface, 1, 0, Seconds (0), Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.1.1.0", interface), true, "connected route not installed");
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.2.0.0", interface), true, "user route not installed");
+
+  ipv4->SetDown (interface);
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.1.1.0", interface), false, "connected route not withdrawn");
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.2.0.0", interface), true, "user route withdrawn with the interface");
+
+  ipv4->SetUp (interface);
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.1.1.0", interface), true, "connected route not restored");
+
+  ipv4->RemoveAddress (interface, 0);
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.1.1.0", interface), false, "connected route kept without its address");
+  NS_TEST_ASSERT_MSG_EQ (HasRoute (routing, "10.2.0.0", interface), true, "user route withdrawn with an address");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Overlapping prefixes in two routing tables, each searched by the
+ * packets received on the interfaces bound to it.
+ */
+class PIOVrfTestCase : public TestCase
+{
+public:
+  PIOVrfTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Route a packet received on a device.
+   * \param routing the routing protocol
+   * \param device the input device
+   * \param destination the destination address
+   * \return the gateway the packet is forwarded to, 255.255.255.255 if no
+   * route was found
+   */
+  Ipv4Address RouteInput (Ptr<PIORoutingProtocol> routing, Ptr<NetDevice> device, const char *destination);
+
+  /**
+   * \brief Unicast forward callback of RouteInput.
+   * \param route the route
+   * \param p the packet
+   * \param header the IP header
+   */
+  void Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header &header);
+
+  Ipv4Address m_gateway; //!< gateway of the last forwarded packet
+};
+
+PIOVrfTestCase::PIOVrfTestCase ()
+  : TestCase ("Routing tables")
+{
+}
+
+void
+PIOVrfTestCase::Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header &header)
+{
+  m_gateway = route->GetGateway ();
+}
+
+Ipv4Address
+PIOVrfTestCase::RouteInput (Ptr<PIORoutingProtocol> routing, Ptr<NetDevice> device, const char *destination)
+{
+  Ipv4Header header;
+  header.SetSource (Ipv4Address ("192.168.0.1"));
+  header.SetDestination (Ipv4Address (destination));
+  header.SetProtocol (17);
+  m_gateway = Ipv4Address::GetBroadcast ();
+  routing->RouteInput (Create<Packet> (), header, device,
+                       MakeCallback (&PIOVrfTestCase::Forward, this),
+                       Ipv4RoutingProtocol::MulticastForwardCallback (),
+                       Ipv4RoutingProtocol::LocalDeliverCallback (),
+                       Ipv4RoutingProtocol::ErrorCallback ());
+  return m_gateway;
+}
+
+void
+PIOVrfTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  PIOHelper pio;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (pio);
+  internet.Install (node);
+
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  Ptr<PIORoutingProtocol> routing = pio.GetPIORouting (ipv4);
+  NS_TEST_ASSERT_MSG_EQ (routing != 0, true, "PIO routing not installed");
+
+  // interfaces 1 and 3 in the main table, interface 2 in table 1
+  const char *addresses[] = { "10.1.1.1", "10.2.2.1", "10.3.3.1" };
+  std::vector<Ptr<NetDevice> > devices;
+  for (uint32_t n = 0; n < 3; n++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      node->AddDevice (device);
+      uint32_t interface = ipv4->AddInterface (device);
+      ipv4->AddAddress (interface, Ipv4InterfaceAddress (Ipv4Address (addresses[n]), Ipv4Mask ("255.255.255.0")));
+      ipv4->SetUp (interface);
+      devices.push_back (device);
+    }
+  uint32_t table = routing->AddTable ();
+  NS_TEST_ASSERT_MSG_EQ (table, 1, "wrong identifier of the first table");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetNTables (), 2, "wrong number of tables");
+  routing->SetInterfaceTable (2, table);
+
+  std::vector<PIORouteSpec> mainRoutes;
+  mainRoutes.push_back (PIORouteSpec (Ipv4Address ("172.16.0.0"), Ipv4Mask ("255.255.0.0"), Ipv4Address ("10.1.1.2"), 1, 1, 0, Seconds (0), Seconds (0)));
+  NS_TEST_ASSERT_MSG_EQ (routing->AddRoutes (0, mainRoutes), 1, "route not installed in the main table");
+
+  // the same prefix, and a more specific one, in table 1
+  std::vector<PIORouteSpec> vrfRoutes;
+  vrfRoutes.push_back (PIORouteSpec (Ipv4Address ("172.16.0.0"), Ipv4Mask ("255.255.0.0"), Ipv4Address ("10.2.2.2"), 2, 1, 0, Seconds (0), Seconds (0)));
+  vrfRoutes.push_back (PIORouteSpec (Ipv4Address ("172.16.5.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("10.2.2.3"), 2, 1, 0, Seconds (0), Seconds (0)));
+  NS_TEST_ASSERT_MSG_EQ (routing->AddRoutes (table, vrfRoutes), 2, "routes not installed in table 1");
+  NS_TEST_ASSERT_MSG_EQ (routing->AddRoutes (table, vrfRoutes), 0, "duplicate routes installed in table 1");
+
+  NS_TEST_EXPECT_MSG_EQ (RouteInput (routing, devices[0], "172.16.9.9"), Ipv4Address ("10.1.1.2"), "main table not used on interface 1");
+  NS_TEST_EXPECT_MSG_EQ (RouteInput (routing, devices[2], "172.16.5.1"), Ipv4Address ("10.1.1.2"), "route of table 1 used on interface 3");
+  NS_TEST_EXPECT_MSG_EQ (RouteInput (routing, devices[1], "172.16.9.9"), Ipv4Address ("10.2.2.2"), "table 1 not used on interface 2");
+  NS_TEST_EXPECT_MSG_EQ (RouteInput (routing, devices[1], "172.16.5.1"), Ipv4Address ("10.2.2.3"), "longest match not taken in table 1");
+
+  // the routes of table 1 are not in the main table
+  std::vector<PIOSnapshotRecord> records;
+  routing->SaveRoutes (0, records);
+  for (std::vector<PIOSnapshotRecord>::const_iterator it = records.begin (); it != records.end (); it++)
+    {
+      NS_TEST_EXPECT_MSG_NE (Ipv4Address (it->gateway), Ipv4Address ("10.2.2.2"), "route of table 1 in the main table");
+      NS_TEST_EXPECT_MSG_NE (Ipv4Address (it->gateway), Ipv4Address ("10.2.2.3"), "route of table 1 in the main table");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \param routing the routing protocol
+ * \param network network address
+ * \param gateway gateway address
+ * \return the metric of the route to the network through the gateway, 0 if
+ * no such route is in the table or it is INVALID
+ */
+static uint16_t
+GetRouteMetric (Ptr<PIORoutingProtocol> routing, const char *network, const char *gateway)
+{
+  std::vector<PIOSnapshotRecord> records;
+  routing->SaveRoutes (0, records);
+  for (std::vector<PIOSnapshotRecord>::const_iterator it = records.begin (); it != records.end (); it++)
+    {
+      if (Ipv4Address (it->network) == Ipv4Address (network) && Ipv4Address (it->gateway) == Ipv4Address (gateway))
+        {
+          return it->metric;
+        }
+    }
+  return 0;
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief A node whose best next hop goes down advertises the path it
+ * forwards along: with poison reverse, the prefix is poisoned towards the
+ * neighbor it now goes through, and advertised again when the link is back.
+ *
+ * Triangle A, B, C; C advertises 10.0.9.0/24. B reaches it through C, and
+ * through A as a loop-free alternate.
+ */
+class PIOLinkDownTestCase : public TestCase
+{
+public:
+  PIOLinkDownTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Connect two nodes by a link.
+   * \param a first node, given the address .1
+   * \param b second node, given the address .2
+   * \param network the network of the link, a /24
+   * \return the interface of the link on the first node
+   */
+  static uint32_t Connect (Ptr<Node> a, Ptr<Node> b, const char *network);
+
+  /**
+   * \brief Check the route of A to 10.0.9.0/24 through B.
+   * \param metric the metric expected, 0 if the route is expected to be
+   * absent or INVALID
+   * \param message the message of the check
+   */
+  void CheckRouteThroughB (uint16_t metric, std::string message);
+
+  Ptr<PIORoutingProtocol> m_routingA; //!< routing protocol of A
+};
+
+PIOLinkDownTestCase::PIOLinkDownTestCase ()
+  : TestCase ("Re-advertisement on a link failure")
+{
+}
+
+uint32_t
+PIOLinkDownTestCase::Connect (Ptr<Node> a, Ptr<Node> b, const char *network)
+{
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  uint32_t interfaces[2];
+  Ptr<Node> nodes[2] = { a, b };
+  for (uint32_t n = 0; n < 2; n++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetChannel (channel);
+      nodes[n]->AddDevice (device);
+      Ptr<Ipv4> ipv4 = nodes[n]->GetObject<Ipv4> ();
+      interfaces[n] = ipv4->AddInterface (device);
+      Ipv4Address address (Ipv4Address (network).Get () + n + 1);
+      ipv4->AddAddress (interfaces[n], Ipv4InterfaceAddress (address, Ipv4Mask ("255.255.255.0")));
+      ipv4->SetUp (interfaces[n]);
+    }
+  return interfaces[0];
+}
+
+void
+PIOLinkDownTestCase::CheckRouteThroughB (uint16_t metric, std::string message)
+{
+  NS_TEST_EXPECT_MSG_EQ (GetRouteMetric (m_routingA, "10.0.9.0", "10.0.1.2"), metric, message);
+}
+
+void
+PIOLinkDownTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (3);
+  PIOHelper pio;
+  pio.Set ("SplitHorizon", EnumValue (POISON_REVERSE));
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (pio);
+  internet.Install (nodes);
+
+  Connect (nodes.Get (0), nodes.Get (1), "10.0.1.0");
+  Connect (nodes.Get (0), nodes.Get (2), "10.0.2.0");
+  uint32_t linkBC = Connect (nodes.Get (1), nodes.Get (2), "10.0.3.0");
+
+  m_routingA = pio.GetPIORouting (nodes.Get (0)->GetObject<Ipv4> ());
+  Ptr<PIORoutingProtocol> routingC = pio.GetPIORouting (nodes.Get (2)->GetObject<Ipv4> ());
+  std::vector<PIORouteSpec> routes;
+  routes.push_back (PIORouteSpec (Ipv4Address ("10.0.9.0"), Ipv4Mask ("255.255.255.0"), 0, 1, 0, Seconds (0), Seconds (0)));
+  NS_TEST_ASSERT_MSG_EQ (routingC->AddRoutes (routes), 1, "route not installed on C");
+
+  // B advertises its path through C to A; A prefers its own link to C
+  Simulator::Schedule (Seconds (20), &PIOLinkDownTestCase::CheckRouteThroughB, this, 3, "B does not advertise its path through C");
+
+  // B now forwards through A: the prefix is poisoned towards A
+  Ptr<Ipv4> ipv4B = nodes.Get (1)->GetObject<Ipv4> ();
+  Simulator::Schedule (Seconds (25), &Ipv4::SetDown, ipv4B, linkBC);
+  Simulator::Schedule (Seconds (35), &PIOLinkDownTestCase::CheckRouteThroughB, this, 0, "B advertises a path through a down link");
+
+  // B forwards through C again
+  Simulator::Schedule (Seconds (40), &Ipv4::SetUp, ipv4B, linkBC);
+  Simulator::Schedule (Seconds (50), &PIOLinkDownTestCase::CheckRouteThroughB, this, 3, "B does not advertise its path through C again");
+
+  Simulator::Stop (Seconds (55));
+  Simulator::Run ();
+  m_routingA = 0;
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO routing protocol test suite
+ */
+class PIORoutingTestSuite : public TestSuite
+{
+public:
+  PIORoutingTestSuite () : TestSuite ("pio-routing", UNIT)
+  {
+    AddTestCase (new PIORoutingEntrySizeTestCase, TestCase::QUICK);
+    AddTestCase (new PIOConnectedRouteTestCase, TestCase::QUICK);
+    AddTestCase (new PIOVrfTestCase, TestCase::QUICK);
+    AddTestCase (new PIOLinkDownTestCase, TestCase::QUICK);
+  }
+};
+
+static PIORoutingTestSuite g_pioRoutingTestSuite; //!< Static variable for test initialization
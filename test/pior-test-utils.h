@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#ifndef PIOR_TEST_UTILS_H
+#define PIOR_TEST_UTILS_H
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup PIO
+ * Helpers shared by the PIO test suites.
+ */
+
+/**
+ * \brief Linear congruential generator, so that the tests do not depend on
+ * the random number streams of the simulator.
+ * \param state generator state
+ * \return the next 32-bit value
+ */
+inline uint32_t
+NextRandom (uint32_t &state)
+{
+  state = state * 1664525 + 1013904223;
+  return state ^ (state >> 16);
+}
+
+/**
+ * \param length prefix length
+ * \return the network mask of the given length
+ */
+inline uint32_t
+MaskOf (uint8_t length)
+{
+  return length == 0 ? 0 : (0xffffffff << (32 - length));
+}
+
+#endif /* PIOR_TEST_UTILS_H */
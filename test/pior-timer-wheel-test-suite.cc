@@ -0,0 +1,275 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Janaka Wijekoon, Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Piotr Lechowicz <piotr.lechowicz@nokia.com>
+ */
+
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/pior-timer-wheel.h"
+
+#include "pior-test-utils.h"
+
+using namespace ns3;
+
+/// Wheel carrying the index of the timer in the test
+typedef PIOTimerWheel<uint32_t> TestTimerWheel;
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Expiry of timers placed in every level and in the overflow list,
+ * and cancellation of pending and due timers.
+ */
+class PIOTimerWheelLevelsTestCase : public TestCase
+{
+public:
+  PIOTimerWheelLevelsTestCase ();
+  virtual void DoRun (void);
+};
+
+PIOTimerWheelLevelsTestCase::PIOTimerWheelLevelsTestCase ()
+  : TestCase ("Expiry and cancellation across the levels")
+{
+}
+
+void
+PIOTimerWheelLevelsTestCase::DoRun (void)
+{
+  TestTimerWheel wheel;
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNextTick (), TestTimerWheel::NEVER, "work in an empty wheel");
+
+  // the first and last ticks of the spans of every level; the top level
+  // spans 2^24 ticks, timers beyond wait in the overflow list
+  const uint64_t expiries[] = { 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+                                16777215, 16777216, 16777217, 50331653, 50331653 };
+  const uint32_t nExpiries = sizeof (expiries) / sizeof (expiries[0]);
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < nExpiries; i++)
+    {
+      ids.push_back (wheel.Schedule (expiries[i], i));
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetExpiry (ids.back ()), expiries[i], "wrong expiry");
+    }
+
+  // cancel a pending timer in the level 1, in the level 3 and in the overflow list
+  wheel.Cancel (ids[3]);
+  wheel.Cancel (ids[10]);
+  wheel.Cancel (ids[14]);
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNTimers (), nExpiries - 3, "wrong timer count after cancellations");
+
+  // advance from one tick needing work to the next, the timers popping at
+  // their expiry tick and never before
+  std::vector<uint64_t> popped (nExpiries, TestTimerWheel::NEVER);
+  uint32_t steps = 0;
+  while (wheel.GetNextTick () != TestTimerWheel::NEVER)
+    {
+      uint64_t next = wheel.GetNextTick ();
+      NS_TEST_ASSERT_MSG_GT (next, wheel.GetNow (), "next tick not in the future");
+      wheel.Advance (next);
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetNow (), next, "wheel not advanced");
+
+      uint32_t index;
+      while (wheel.PopDue (index))
+        {
+          popped[index] = wheel.GetNow ();
+        }
+      NS_TEST_ASSERT_MSG_EQ (wheel.HasDue (), false, "due timer left");
+      NS_TEST_ASSERT_MSG_LT (++steps, 1000, "too many steps to empty the wheel");
+      if (steps >= 1000)
+        {
+          break;
+        }
+    }
+  for (uint32_t i = 0; i < nExpiries; i++)
+    {
+      uint64_t expected = (i == 3 || i == 10 || i == 14) ? TestTimerWheel::NEVER : expiries[i];
+      NS_TEST_ASSERT_MSG_EQ (popped[i], expected, "timer " << i << " popped at the wrong tick");
+    }
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNTimers (), 0, "timers left in an empty wheel");
+
+  // a due timer can be cancelled while the others are processed
+  uint64_t now = wheel.GetNow ();
+  uint32_t first = wheel.Schedule (now + 10, 0);
+  uint32_t second = wheel.Schedule (now + 10, 1);
+  wheel.Advance (now + 20);
+  NS_TEST_ASSERT_MSG_EQ (wheel.HasDue (), true, "expired timers not due");
+  uint32_t index;
+  NS_TEST_ASSERT_MSG_EQ (wheel.PopDue (index), true, "no due timer");
+  wheel.Cancel (index == 0 ? second : first);
+  NS_TEST_ASSERT_MSG_EQ (wheel.PopDue (index), false, "cancelled due timer popped");
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNTimers (), 0, "timers left in an empty wheel");
+
+  // an expiry already reached is moved to the next tick
+  uint32_t late = wheel.Schedule (now, 0);
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetExpiry (late), now + 21, "past expiry not moved to the next tick");
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNextTick (), now + 21, "wrong next tick");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Timers scheduled after the wheel was left idle while the owner's
+ * clock moved on.
+ */
+class PIOTimerWheelIdleTestCase : public TestCase
+{
+public:
+  PIOTimerWheelIdleTestCase ();
+  virtual void DoRun (void);
+};
+
+PIOTimerWheelIdleTestCase::PIOTimerWheelIdleTestCase ()
+  : TestCase ("Scheduling after an idle period")
+{
+}
+
+void
+PIOTimerWheelIdleTestCase::DoRun (void)
+{
+  TestTimerWheel wheel;
+
+  // an empty wheel jumps to the current tick
+  wheel.Advance (100000);
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNow (), 100000, "empty wheel not advanced");
+  wheel.Schedule (100050, 0);
+  NS_TEST_ASSERT_MSG_GT (wheel.GetNextTick (), 100000, "timer not placed relative to the current tick");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (wheel.GetNextTick (), 100050, "timer not placed relative to the current tick");
+
+  // a wheel holding a far timer is advanced over several levels at once;
+  // the timers scheduled then are placed relative to the new tick
+  wheel.Schedule (5000000, 1);
+  wheel.Advance (4200000);
+  uint32_t index;
+  NS_TEST_ASSERT_MSG_EQ (wheel.PopDue (index) && index == 0, true, "timer expired during the idle period not due");
+  NS_TEST_ASSERT_MSG_EQ (wheel.HasDue (), false, "due timer left");
+  wheel.Schedule (4200010, 2);
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNextTick (), 4200010, "timer not placed relative to the current tick");
+  NS_TEST_ASSERT_MSG_GT (wheel.GetNextTick (), wheel.GetNow (), "next tick in the past");
+
+  wheel.Advance (4200010);
+  NS_TEST_ASSERT_MSG_EQ (wheel.PopDue (index) && index == 2, true, "timer not expired");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (wheel.GetNextTick (), 5000000, "far timer lost");
+  while (wheel.GetNextTick () != TestTimerWheel::NEVER)
+    {
+      wheel.Advance (wheel.GetNextTick ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (wheel.PopDue (index) && index == 1, true, "far timer not expired");
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNow (), 5000000, "far timer expired at the wrong tick");
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief Random schedules, cancellations and advances of arbitrary length,
+ * checked against the set of armed timers.
+ */
+class PIOTimerWheelRandomTestCase : public TestCase
+{
+public:
+  PIOTimerWheelRandomTestCase ();
+  virtual void DoRun (void);
+};
+
+PIOTimerWheelRandomTestCase::PIOTimerWheelRandomTestCase ()
+  : TestCase ("Random schedules against a reference")
+{
+}
+
+void
+PIOTimerWheelRandomTestCase::DoRun (void)
+{
+  TestTimerWheel wheel;
+  std::map<uint32_t, std::pair<uint32_t, uint64_t> > armed; // index -> (id, expiry)
+  uint32_t state = 3;
+  uint32_t nextIndex = 0;
+
+  for (uint32_t round = 0; round < 2000; round++)
+    {
+      uint32_t action = NextRandom (state) % 8;
+      if (action < 4)
+        {
+          // delays up to four times the span of the wheel
+          uint32_t bits = NextRandom (state) % 27;
+          uint64_t expiry = wheel.GetNow () + 1 + (NextRandom (state) & ((uint32_t (1) << bits) - 1));
+          uint32_t id = wheel.Schedule (expiry, nextIndex);
+          armed[nextIndex++] = std::make_pair (id, expiry);
+        }
+      else if (action < 5 && !armed.empty ())
+        {
+          std::map<uint32_t, std::pair<uint32_t, uint64_t> >::iterator it = armed.begin ();
+          std::advance (it, NextRandom (state) % armed.size ());
+          wheel.Cancel (it->second.first);
+          armed.erase (it);
+        }
+      else
+        {
+          uint64_t now = wheel.GetNow () + (NextRandom (state) & ((uint32_t (1) << (NextRandom (state) % 25)) - 1));
+          wheel.Advance (now);
+          NS_TEST_ASSERT_MSG_EQ (wheel.GetNow (), now, "wheel not advanced");
+
+          uint32_t index;
+          while (wheel.PopDue (index))
+            {
+              std::map<uint32_t, std::pair<uint32_t, uint64_t> >::iterator it = armed.find (index);
+              NS_TEST_ASSERT_MSG_EQ (it != armed.end (), true, "unknown or cancelled timer popped");
+              if (it != armed.end ())
+                {
+                  NS_TEST_ASSERT_MSG_LT_OR_EQ (it->second.second, now, "timer popped before its expiry");
+                  armed.erase (it);
+                }
+            }
+          for (std::map<uint32_t, std::pair<uint32_t, uint64_t> >::const_iterator it = armed.begin (); it != armed.end (); it++)
+            {
+              NS_TEST_ASSERT_MSG_GT (it->second.second, now, "expired timer " << it->first << " not popped");
+            }
+        }
+
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetNTimers (), armed.size (), "wrong timer count");
+      uint64_t earliest = TestTimerWheel::NEVER;
+      for (std::map<uint32_t, std::pair<uint32_t, uint64_t> >::const_iterator it = armed.begin (); it != armed.end (); it++)
+        {
+          earliest = it->second.second < earliest ? it->second.second : earliest;
+        }
+      NS_TEST_ASSERT_MSG_LT_OR_EQ (wheel.GetNextTick (), earliest, "next tick after the earliest expiry");
+      NS_TEST_ASSERT_MSG_GT (wheel.GetNextTick (), wheel.GetNow (), "next tick not in the future");
+    }
+}
+
+/**
+ * \ingroup PIO
+ * \ingroup tests
+ *
+ * \brief PIO timer wheel test suite
+ */
+class PIOTimerWheelTestSuite : public TestSuite
+{
+public:
+  PIOTimerWheelTestSuite () : TestSuite ("pio-timer-wheel", UNIT)
+  {
+    AddTestCase (new PIOTimerWheelLevelsTestCase, TestCase::QUICK);
+    AddTestCase (new PIOTimerWheelIdleTestCase, TestCase::QUICK);
+    AddTestCase (new PIOTimerWheelRandomTestCase, TestCase::QUICK);
+  }
+};
+
+static PIOTimerWheelTestSuite g_pioTimerWheelTestSuite; //!< Static variable for test initialization